@@ -0,0 +1,304 @@
+#define _POSIX_C_SOURCE 200809L
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cbor.h"
+
+#define CBOR_UINT 0
+#define CBOR_NEGINT 1
+#define CBOR_BYTES 2
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_TAG 6
+#define CBOR_SIMPLE 7
+
+#define CBOR_FALSE 0xf4
+#define CBOR_TRUE 0xf5
+#define CBOR_NULL 0xf6
+#define CBOR_UNDEFINED 0xf7
+#define CBOR_FLOAT32 0xfa
+#define CBOR_FLOAT64 0xfb
+
+// Nesting deeper than this is rejected by the decoder
+#define CBOR_MAX_DEPTH 256
+
+struct cbor_writer {
+	uint8_t *data;
+	size_t length;
+	size_t capacity;
+	bool failed;
+};
+
+static void cbor_write(struct cbor_writer *w, const void *data, size_t len) {
+	if (w->failed) {
+		return;
+	}
+	if (w->length + len > w->capacity) {
+		size_t capacity = w->capacity ? w->capacity : 256;
+		while (w->length + len > capacity) {
+			capacity *= 2;
+		}
+		uint8_t *new_data = realloc(w->data, capacity);
+		if (!new_data) {
+			w->failed = true;
+			return;
+		}
+		w->data = new_data;
+		w->capacity = capacity;
+	}
+	memcpy(w->data + w->length, data, len);
+	w->length += len;
+}
+
+/**
+ * Writes an initial byte with the given major type and its argument, using
+ * the shortest encoding of the argument.
+ */
+static void cbor_write_head(struct cbor_writer *w, uint8_t major,
+		uint64_t value) {
+	uint8_t head[9];
+	size_t size;
+	if (value < 24) {
+		head[0] = major << 5 | value;
+		size = 1;
+	} else if (value <= UINT8_MAX) {
+		head[0] = major << 5 | 24;
+		size = 2;
+	} else if (value <= UINT16_MAX) {
+		head[0] = major << 5 | 25;
+		size = 3;
+	} else if (value <= UINT32_MAX) {
+		head[0] = major << 5 | 26;
+		size = 5;
+	} else {
+		head[0] = major << 5 | 27;
+		size = 9;
+	}
+	// Arguments are big endian
+	for (size_t i = size - 1; i > 0; --i) {
+		head[i] = value & 0xff;
+		value >>= 8;
+	}
+	cbor_write(w, head, size);
+}
+
+static void cbor_write_json(struct cbor_writer *w, json_object *obj) {
+	uint8_t byte;
+	switch (json_object_get_type(obj)) {
+	case json_type_null:
+		byte = CBOR_NULL;
+		cbor_write(w, &byte, 1);
+		break;
+	case json_type_boolean:
+		byte = json_object_get_boolean(obj) ? CBOR_TRUE : CBOR_FALSE;
+		cbor_write(w, &byte, 1);
+		break;
+	case json_type_int:;
+		int64_t value = json_object_get_int64(obj);
+		if (value >= 0) {
+			cbor_write_head(w, CBOR_UINT, (uint64_t)value);
+		} else {
+			cbor_write_head(w, CBOR_NEGINT, (uint64_t)(-1 - value));
+		}
+		break;
+	case json_type_double:;
+		double d = json_object_get_double(obj);
+		uint64_t bits;
+		memcpy(&bits, &d, sizeof(bits));
+		uint8_t buf[9] = { CBOR_FLOAT64 };
+		for (size_t i = 8; i > 0; --i) {
+			buf[i] = bits & 0xff;
+			bits >>= 8;
+		}
+		cbor_write(w, buf, sizeof(buf));
+		break;
+	case json_type_string:;
+		int len = json_object_get_string_len(obj);
+		cbor_write_head(w, CBOR_TEXT, (uint64_t)len);
+		cbor_write(w, json_object_get_string(obj), (size_t)len);
+		break;
+	case json_type_array:;
+		size_t length = json_object_array_length(obj);
+		cbor_write_head(w, CBOR_ARRAY, length);
+		for (size_t i = 0; i < length; ++i) {
+			cbor_write_json(w, json_object_array_get_idx(obj, i));
+		}
+		break;
+	case json_type_object:
+		cbor_write_head(w, CBOR_MAP, (uint64_t)json_object_object_length(obj));
+		json_object_object_foreach(obj, key, val) {
+			size_t key_len = strlen(key);
+			cbor_write_head(w, CBOR_TEXT, key_len);
+			cbor_write(w, key, key_len);
+			cbor_write_json(w, val);
+		}
+		break;
+	}
+}
+
+uint8_t *cbor_encode_json(json_object *obj, size_t *len) {
+	struct cbor_writer w = {0};
+	cbor_write_json(&w, obj);
+	if (w.failed) {
+		free(w.data);
+		return NULL;
+	}
+	*len = w.length;
+	return w.data;
+}
+
+struct cbor_reader {
+	const uint8_t *data;
+	size_t length;
+	size_t offset;
+};
+
+static bool cbor_read_head(struct cbor_reader *r, uint8_t *major,
+		uint8_t *info, uint64_t *value) {
+	if (r->offset >= r->length) {
+		return false;
+	}
+	uint8_t byte = r->data[r->offset++];
+	*major = byte >> 5;
+	*info = byte & 0x1f;
+	size_t size;
+	if (*info < 24) {
+		*value = *info;
+		return true;
+	} else if (*info == 24) {
+		size = 1;
+	} else if (*info == 25) {
+		size = 2;
+	} else if (*info == 26) {
+		size = 4;
+	} else if (*info == 27) {
+		size = 8;
+	} else {
+		// Reserved values and indefinite lengths
+		return false;
+	}
+	if (r->length - r->offset < size) {
+		return false;
+	}
+	*value = 0;
+	for (size_t i = 0; i < size; ++i) {
+		*value = *value << 8 | r->data[r->offset++];
+	}
+	return true;
+}
+
+static bool cbor_read_json(struct cbor_reader *r, json_object **out,
+		int depth) {
+	uint8_t major, info;
+	uint64_t value;
+	if (depth > CBOR_MAX_DEPTH || !cbor_read_head(r, &major, &info, &value)) {
+		return false;
+	}
+
+	switch (major) {
+	case CBOR_UINT:
+		if (value > INT64_MAX) {
+			return false;
+		}
+		*out = json_object_new_int64((int64_t)value);
+		return *out != NULL;
+	case CBOR_NEGINT:
+		if (value > INT64_MAX) {
+			return false;
+		}
+		*out = json_object_new_int64(-1 - (int64_t)value);
+		return *out != NULL;
+	case CBOR_TEXT:
+		if (value > r->length - r->offset || value > INT_MAX) {
+			return false;
+		}
+		*out = json_object_new_string_len(
+				(const char *)r->data + r->offset, (int)value);
+		r->offset += value;
+		return *out != NULL;
+	case CBOR_ARRAY:
+		// Every item takes at least one byte
+		if (value > r->length - r->offset) {
+			return false;
+		}
+		*out = json_object_new_array();
+		if (!*out) {
+			return false;
+		}
+		for (uint64_t i = 0; i < value; ++i) {
+			json_object *item = NULL;
+			if (!cbor_read_json(r, &item, depth + 1)) {
+				json_object_put(*out);
+				return false;
+			}
+			json_object_array_add(*out, item);
+		}
+		return true;
+	case CBOR_MAP:
+		if (value > (r->length - r->offset) / 2) {
+			return false;
+		}
+		*out = json_object_new_object();
+		if (!*out) {
+			return false;
+		}
+		for (uint64_t i = 0; i < value; ++i) {
+			json_object *key = NULL, *item = NULL;
+			if (r->offset >= r->length ||
+					r->data[r->offset] >> 5 != CBOR_TEXT ||
+					!cbor_read_json(r, &key, depth + 1)) {
+				json_object_put(*out);
+				return false;
+			}
+			if (!cbor_read_json(r, &item, depth + 1)) {
+				json_object_put(key);
+				json_object_put(*out);
+				return false;
+			}
+			json_object_object_add(*out, json_object_get_string(key), item);
+			json_object_put(key);
+		}
+		return true;
+	case CBOR_SIMPLE:
+		switch (major << 5 | info) {
+		case CBOR_FALSE:
+		case CBOR_TRUE:
+			*out = json_object_new_boolean(info == (CBOR_TRUE & 0x1f));
+			return *out != NULL;
+		case CBOR_NULL:
+		case CBOR_UNDEFINED:
+			*out = NULL;
+			return true;
+		case CBOR_FLOAT32:;
+			uint32_t bits32 = (uint32_t)value;
+			float f;
+			memcpy(&f, &bits32, sizeof(f));
+			*out = json_object_new_double(f);
+			return *out != NULL;
+		case CBOR_FLOAT64:;
+			double d;
+			memcpy(&d, &value, sizeof(d));
+			*out = json_object_new_double(d);
+			return *out != NULL;
+		}
+		return false;
+	default:
+		// Byte strings and tags have no JSON equivalent
+		return false;
+	}
+}
+
+bool cbor_decode_json(const uint8_t *data, size_t len, json_object **out) {
+	struct cbor_reader r = { .data = data, .length = len };
+	json_object *obj = NULL;
+	if (!cbor_read_json(&r, &obj, 0)) {
+		return false;
+	}
+	if (r.offset != r.length) {
+		json_object_put(obj);
+		return false;
+	}
+	*out = obj;
+	return true;
+}
@@ -6,6 +6,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
+#include <json.h>
 #include "ipc-client.h"
 #include "log.h"
 
@@ -147,3 +148,19 @@ char *ipc_single_command(int socketfd, uint32_t type, const char *payload, uint3
 
 	return response;
 }
+
+bool ipc_set_encoding(int socketfd, const char *encoding) {
+	uint32_t len = strlen(encoding);
+	char *resp = ipc_single_command(socketfd, IPC_SET_ENCODING, encoding, &len);
+	json_object *obj = json_tokener_parse(resp);
+	free(resp);
+
+	json_object *success;
+	bool ret = obj && json_object_object_get_ex(obj, "success", &success) &&
+		json_object_get_boolean(success);
+	if (!ret) {
+		sway_log(SWAY_ERROR, "Unable to set IPC encoding to %s", encoding);
+	}
+	json_object_put(obj);
+	return ret;
+}
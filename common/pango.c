@@ -1,3 +1,4 @@
+#define _POSIX_C_SOURCE 200809L
 #include <cairo/cairo.h>
 #include <pango/pangocairo.h>
 #include <stdarg.h>
@@ -50,9 +51,75 @@ size_t escape_markup_text(const char *src, char *dest) {
 	return length;
 }
 
-PangoLayout *get_pango_layout(cairo_t *cairo, const char *font,
+#define FONT_DESCRIPTION_CACHE_SIZE 8
+#define TEXT_SIZE_CACHE_SIZE 256
+
+struct font_description_entry {
+	char *font;
+	PangoFontDescription *description;
+};
+
+struct text_size_entry {
+	uint32_t hash;
+	char *font;
+	char *text;
+	double scale;
+	bool markup;
+	unsigned long font_options_hash;
+	int width, height, baseline;
+};
+
+// Font descriptions, most recently used first
+static struct font_description_entry font_descriptions[FONT_DESCRIPTION_CACHE_SIZE];
+// Direct mapped cache of measured text sizes
+static struct text_size_entry text_sizes[TEXT_SIZE_CACHE_SIZE];
+// Layout reused by get_text_size and pango_printf
+static PangoLayout *shared_layout;
+// Buffer for formatted text, reused between calls
+static char *format_buffer;
+static size_t format_buffer_size;
+
+static struct pango_cache_stats cache_stats;
+
+static PangoFontDescription *get_font_description(const char *font) {
+	for (int i = 0; i < FONT_DESCRIPTION_CACHE_SIZE; ++i) {
+		struct font_description_entry *entry = &font_descriptions[i];
+		if (!entry->font) {
+			break;
+		}
+		if (strcmp(entry->font, font) == 0) {
+			cache_stats.font_description_hits++;
+			struct font_description_entry found = *entry;
+			memmove(&font_descriptions[1], &font_descriptions[0],
+					i * sizeof(struct font_description_entry));
+			font_descriptions[0] = found;
+			return found.description;
+		}
+	}
+	cache_stats.font_description_misses++;
+
+	char *copy = strdup(font);
+	if (!copy) {
+		sway_log(SWAY_ERROR, "Failed to allocate memory");
+		return NULL;
+	}
+	struct font_description_entry *last =
+		&font_descriptions[FONT_DESCRIPTION_CACHE_SIZE - 1];
+	if (last->font) {
+		free(last->font);
+		pango_font_description_free(last->description);
+	}
+	memmove(&font_descriptions[1], &font_descriptions[0],
+			(FONT_DESCRIPTION_CACHE_SIZE - 1) *
+			sizeof(struct font_description_entry));
+	font_descriptions[0].font = copy;
+	font_descriptions[0].description =
+		pango_font_description_from_string(font);
+	return font_descriptions[0].description;
+}
+
+static void set_layout_text(PangoLayout *layout, const char *font,
 		const char *text, double scale, bool markup) {
-	PangoLayout *layout = pango_cairo_create_layout(cairo);
 	PangoAttrList *attrs;
 	if (markup) {
 		char *buf;
@@ -73,66 +140,192 @@ PangoLayout *get_pango_layout(cairo_t *cairo, const char *font,
 	}
 
 	pango_attr_list_insert(attrs, pango_attr_scale_new(scale));
-	PangoFontDescription *desc = pango_font_description_from_string(font);
+	PangoFontDescription *desc = get_font_description(font);
 	pango_layout_set_font_description(layout, desc);
 	pango_layout_set_single_paragraph_mode(layout, 1);
 	pango_layout_set_attributes(layout, attrs);
 	pango_attr_list_unref(attrs);
-	pango_font_description_free(desc);
+}
+
+PangoLayout *get_pango_layout(cairo_t *cairo, const char *font,
+		const char *text, double scale, bool markup) {
+	PangoLayout *layout = pango_cairo_create_layout(cairo);
+	set_layout_text(layout, font, text, scale, markup);
 	return layout;
 }
 
+/**
+ * Return the layout shared by get_text_size and pango_printf, set up for the
+ * given text and updated to match the cairo context.
+ *
+ * A single layout is enough even when drawing to several cairo contexts:
+ * its font, text, attributes and font options are all set on every call,
+ * and pango_cairo_update_layout rebinds the transformation and resolution
+ * of its context to the given cairo context.
+ */
+static PangoLayout *get_shared_layout(cairo_t *cairo, const char *font,
+		const char *text, double scale, bool markup,
+		cairo_font_options_t *fo) {
+	if (shared_layout) {
+		cache_stats.layout_reuses++;
+	} else {
+		shared_layout = pango_cairo_create_layout(cairo);
+	}
+	set_layout_text(shared_layout, font, text, scale, markup);
+	pango_cairo_context_set_font_options(
+			pango_layout_get_context(shared_layout), fo);
+	pango_cairo_update_layout(cairo, shared_layout);
+	return shared_layout;
+}
+
+/**
+ * Format the text into a buffer which is reused between calls. The result is
+ * only valid until the next call.
+ */
+static const char *format_text(const char *fmt, va_list args) {
+	if (strcmp(fmt, "%s") == 0) {
+		const char *text = va_arg(args, const char *);
+		return text ? text : "(null)";
+	}
+
+	va_list args_copy;
+	va_copy(args_copy, args);
+	// Add one since vsnprintf excludes null terminator.
+	size_t length = vsnprintf(NULL, 0, fmt, args_copy) + 1;
+	va_end(args_copy);
+
+	if (length > format_buffer_size) {
+		char *buf = realloc(format_buffer, length);
+		if (buf == NULL) {
+			sway_log(SWAY_ERROR, "Failed to allocate memory");
+			return NULL;
+		}
+		format_buffer = buf;
+		format_buffer_size = length;
+	}
+	vsnprintf(format_buffer, length, fmt, args);
+	return format_buffer;
+}
+
+static uint32_t hash_text_size_key(const char *font, const char *text,
+		double scale, bool markup, unsigned long font_options_hash) {
+	uint32_t hash = 2166136261u;
+	for (const char *c = font; *c; ++c) {
+		hash = (hash ^ (unsigned char)*c) * 16777619u;
+	}
+	for (const char *c = text; *c; ++c) {
+		hash = (hash ^ (unsigned char)*c) * 16777619u;
+	}
+	const unsigned char *bytes = (const unsigned char *)&scale;
+	for (size_t i = 0; i < sizeof(scale); ++i) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	hash = (hash ^ markup) * 16777619u;
+	hash = (hash ^ font_options_hash) * 16777619u;
+	return hash;
+}
+
 void get_text_size(cairo_t *cairo, const char *font, int *width, int *height,
 		int *baseline, double scale, bool markup, const char *fmt, ...) {
 	va_list args;
 	va_start(args, fmt);
-	// Add one since vsnprintf excludes null terminator.
-	int length = vsnprintf(NULL, 0, fmt, args) + 1;
+	const char *text = format_text(fmt, args);
 	va_end(args);
-
-	char *buf = malloc(length);
-	if (buf == NULL) {
-		sway_log(SWAY_ERROR, "Failed to allocate memory");
+	if (text == NULL) {
 		return;
 	}
-	va_start(args, fmt);
-	vsnprintf(buf, length, fmt, args);
-	va_end(args);
 
-	PangoLayout *layout = get_pango_layout(cairo, font, buf, scale, markup);
-	pango_cairo_update_layout(cairo, layout);
-	pango_layout_get_pixel_size(layout, width, height);
+	cairo_font_options_t *fo = cairo_font_options_create();
+	cairo_get_font_options(cairo, fo);
+	unsigned long font_options_hash = cairo_font_options_hash(fo);
+
+	uint32_t hash = hash_text_size_key(font, text, scale, markup,
+			font_options_hash);
+	struct text_size_entry *entry = &text_sizes[hash % TEXT_SIZE_CACHE_SIZE];
+	if (entry->text && entry->hash == hash && entry->scale == scale &&
+			entry->markup == markup &&
+			entry->font_options_hash == font_options_hash &&
+			strcmp(entry->font, font) == 0 &&
+			strcmp(entry->text, text) == 0) {
+		cache_stats.text_size_hits++;
+		cairo_font_options_destroy(fo);
+	} else {
+		cache_stats.text_size_misses++;
+		PangoLayout *layout = get_shared_layout(cairo, font, text, scale,
+				markup, fo);
+		cairo_font_options_destroy(fo);
+
+		free(entry->font);
+		free(entry->text);
+		entry->hash = hash;
+		entry->font = strdup(font);
+		entry->text = strdup(text);
+		entry->scale = scale;
+		entry->markup = markup;
+		entry->font_options_hash = font_options_hash;
+		pango_layout_get_pixel_size(layout, &entry->width, &entry->height);
+		entry->baseline = pango_layout_get_baseline(layout) / PANGO_SCALE;
+		if (!entry->font || !entry->text) {
+			free(entry->font);
+			free(entry->text);
+			entry->font = entry->text = NULL;
+		}
+	}
+
+	if (width) {
+		*width = entry->width;
+	}
+	if (height) {
+		*height = entry->height;
+	}
 	if (baseline) {
-		*baseline = pango_layout_get_baseline(layout) / PANGO_SCALE;
+		*baseline = entry->baseline;
 	}
-	g_object_unref(layout);
-	free(buf);
 }
 
 void pango_printf(cairo_t *cairo, const char *font,
 		double scale, bool markup, const char *fmt, ...) {
 	va_list args;
 	va_start(args, fmt);
-	// Add one since vsnprintf excludes null terminator.
-	int length = vsnprintf(NULL, 0, fmt, args) + 1;
+	const char *text = format_text(fmt, args);
 	va_end(args);
-
-	char *buf = malloc(length);
-	if (buf == NULL) {
-		sway_log(SWAY_ERROR, "Failed to allocate memory");
+	if (text == NULL) {
 		return;
 	}
-	va_start(args, fmt);
-	vsnprintf(buf, length, fmt, args);
-	va_end(args);
 
-	PangoLayout *layout = get_pango_layout(cairo, font, buf, scale, markup);
 	cairo_font_options_t *fo = cairo_font_options_create();
 	cairo_get_font_options(cairo, fo);
-	pango_cairo_context_set_font_options(pango_layout_get_context(layout), fo);
+	PangoLayout *layout = get_shared_layout(cairo, font, text, scale,
+			markup, fo);
 	cairo_font_options_destroy(fo);
-	pango_cairo_update_layout(cairo, layout);
 	pango_cairo_show_layout(cairo, layout);
-	g_object_unref(layout);
-	free(buf);
+}
+
+void get_pango_cache_stats(struct pango_cache_stats *stats) {
+	*stats = cache_stats;
+}
+
+void pango_cache_fini(void) {
+	for (int i = 0; i < FONT_DESCRIPTION_CACHE_SIZE; ++i) {
+		struct font_description_entry *entry = &font_descriptions[i];
+		if (entry->font) {
+			free(entry->font);
+			pango_font_description_free(entry->description);
+		}
+		entry->font = NULL;
+		entry->description = NULL;
+	}
+	for (int i = 0; i < TEXT_SIZE_CACHE_SIZE; ++i) {
+		struct text_size_entry *entry = &text_sizes[i];
+		free(entry->font);
+		free(entry->text);
+		entry->font = entry->text = NULL;
+	}
+	if (shared_layout) {
+		g_object_unref(shared_layout);
+		shared_layout = NULL;
+	}
+	free(format_buffer);
+	format_buffer = NULL;
+	format_buffer_size = 0;
 }
@@ -0,0 +1,30 @@
+#ifndef _SWAY_CBOR_H
+#define _SWAY_CBOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <json.h>
+
+/**
+ * Encodes a JSON value as CBOR (RFC 8949). Objects become maps with text
+ * string keys, integers are encoded in their shortest form and doubles as
+ * 64-bit floats. Only definite length items are produced.
+ *
+ * Returns a newly allocated buffer and sets len to its size, or returns NULL
+ * if memory could not be allocated.
+ */
+uint8_t *cbor_encode_json(json_object *obj, size_t *len);
+
+/**
+ * Decodes a single CBOR data item into a JSON value. This accepts the subset
+ * of CBOR produced by cbor_encode_json plus single precision floats and the
+ * undefined simple value, which is decoded as null.
+ *
+ * Returns false if the data is malformed, has trailing bytes or uses an
+ * unsupported feature such as byte strings or tags. On success, out is set
+ * to the decoded value, which is NULL for a CBOR null.
+ */
+bool cbor_decode_json(const uint8_t *data, size_t len, json_object **out);
+
+#endif
@@ -38,6 +38,12 @@ struct ipc_response *ipc_recv_response(int socketfd);
  * Free ipc_response struct
  */
 void free_ipc_response(struct ipc_response *response);
+/**
+ * Switches the encoding of the replies and events sent by sway on the socket
+ * to "json" or "cbor", see IPC_SET_ENCODING. The socket must still be using
+ * JSON. Returns false if sway refused the encoding.
+ */
+bool ipc_set_encoding(int socketfd, const char *encoding);
 /**
  * Sets the receive timeout for the IPC socket
  */
@@ -22,6 +22,9 @@ enum ipc_command_type {
 	// sway-specific command types
 	IPC_GET_INPUTS = 100,
 	IPC_GET_SEATS = 101,
+	IPC_GET_RENDER_STATS = 102,
+	IPC_GET_TRANSACTION_TRACE = 103,
+	IPC_SET_ENCODING = 104,
 
 	// Events sent from sway to clients. Events have the highest bits set.
 	IPC_EVENT_WORKSPACE = ((1<<31) | 0),
@@ -36,6 +39,8 @@ enum ipc_command_type {
 	// sway-specific event types
 	IPC_EVENT_BAR_STATE_UPDATE = ((1<<31) | 20),
 	IPC_EVENT_INPUT = ((1<<31) | 21),
+	IPC_EVENT_TREE_DELTA = ((1<<31) | 22),
+	IPC_EVENT_BACKPRESSURE = ((1<<31) | 23),
 };
 
 #endif
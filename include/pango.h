@@ -15,9 +15,32 @@
 size_t escape_markup_text(const char *src, char *dest);
 PangoLayout *get_pango_layout(cairo_t *cairo, const char *font,
 		const char *text, double scale, bool markup);
+
+/**
+ * Measure or draw formatted text. Both share a single layout and cache font
+ * descriptions, and get_text_size caches measured sizes, so repeatedly
+ * measuring the same text does not need to lay it out again.
+ */
 void get_text_size(cairo_t *cairo, const char *font, int *width, int *height,
 		int *baseline, double scale, bool markup, const char *fmt, ...);
 void pango_printf(cairo_t *cairo, const char *font,
 		double scale, bool markup, const char *fmt, ...);
 
+struct pango_cache_stats {
+	uint64_t font_description_hits, font_description_misses;
+	uint64_t text_size_hits, text_size_misses;
+	uint64_t layout_reuses;
+};
+
+/**
+ * Return the hit and miss counters of the text caches.
+ */
+void get_pango_cache_stats(struct pango_cache_stats *stats);
+
+/**
+ * Free the text caches and the shared layout. They are set up again on the
+ * next call to get_text_size or pango_printf.
+ */
+void pango_cache_fini(void);
+
 #endif
@@ -230,6 +230,12 @@ enum scale_filter_mode {
 	SCALE_FILTER_SMART,
 };
 
+/**
+ * Value of output_config::max_render_time for learning the max render time
+ * from measured render durations.
+ */
+#define MAX_RENDER_TIME_ADAPTIVE -2
+
 /**
  * Size and position configuration for a particular output.
  *
@@ -246,7 +252,7 @@ struct output_config {
 	enum scale_filter_mode scale_filter;
 	int32_t transform;
 	enum wl_output_subpixel subpixel;
-	int max_render_time; // In milliseconds
+	int max_render_time; // In milliseconds, or MAX_RENDER_TIME_ADAPTIVE
 	int adaptive_sync;
 
 	char *background;
@@ -432,6 +438,12 @@ enum xwayland_mode {
 	XWAYLAND_MODE_IMMEDIATE,
 };
 
+/**
+ * Value of sway_config::occluded_frame_rate for leaving views covered by
+ * opaque surfaces alone. Hidden views get no frame callbacks, like with 0.
+ */
+#define OCCLUDED_FRAME_RATE_OFF -1
+
 /**
  * The configuration struct. The result of loading a config file.
  */
@@ -491,6 +503,8 @@ struct sway_config {
 	bool auto_back_and_forth;
 	bool show_marks;
 	enum alignment title_align;
+	int title_update_interval; // In milliseconds
+	int occluded_frame_rate; // Frames per second, 0 for none, or OFF
 
 	bool tiling_drag;
 	int tiling_drag_threshold;
@@ -677,11 +691,23 @@ void free_workspace_config(struct workspace_config *wsc);
  * reported by each container. If recalculate is true, the containers will
  * recalculate their heights before reporting.
  *
+ * The maximum is maintained incrementally as containers report their title
+ * metrics, so this is only proportional to the number of containers when
+ * recalculate is true.
+ *
  * If the height has changed, all containers will be rearranged to take on the
  * new size.
  */
 void config_update_font_height(bool recalculate);
 
+/**
+ * Add or remove a container's title height and baseline from the aggregate
+ * used by config_update_font_height.
+ */
+void config_add_title_metrics(size_t height, size_t baseline);
+
+void config_remove_title_metrics(size_t height, size_t baseline);
+
 /**
  * Convert bindsym into bindcode using the first configured layout.
  * Return false in case the conversion is unsuccessful.
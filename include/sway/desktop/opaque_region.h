@@ -0,0 +1,47 @@
+#ifndef _SWAY_OPAQUE_REGION_H
+#define _SWAY_OPAQUE_REGION_H
+#include <stdbool.h>
+#include <pixman.h>
+
+struct sway_output;
+struct sway_workspace;
+
+/**
+ * Collectors for the areas of an output which are hidden behind opaque
+ * surfaces. They are shared by the renderer, which skips drawing hidden
+ * areas, and by frame callbacks, which throttle hidden surfaces, so that
+ * both agree on what can be seen.
+ *
+ * All regions are output-buffer-local and follow what is actually drawn:
+ * translucent containers and views showing saved buffers don't hide
+ * anything.
+ */
+
+/**
+ * Whether opaque regions may be used to hide surfaces on the output. This is
+ * only the case at integer scales, where opaque regions line up exactly with
+ * the pixels they cover.
+ */
+bool opaque_region_usable(struct sway_output *output);
+
+/**
+ * Add the opaque regions of the mapped surfaces in the output's top layer.
+ */
+void opaque_region_add_top_layer(struct sway_output *output,
+		pixman_region32_t *occluded);
+
+/**
+ * Add the opaque regions of the floating views shown on the output, including
+ * those of floating containers on other outputs which overlap it.
+ */
+void opaque_region_add_floating(struct sway_output *output,
+		pixman_region32_t *occluded);
+
+/**
+ * Add the opaque regions of the tiling views of the workspace which are
+ * shown, so not those in inactive tabs or stacks.
+ */
+void opaque_region_add_tiling(struct sway_output *output,
+		struct sway_workspace *workspace, pixman_region32_t *occluded);
+
+#endif
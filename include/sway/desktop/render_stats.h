@@ -0,0 +1,96 @@
+#ifndef _SWAY_RENDER_STATS_H
+#define _SWAY_RENDER_STATS_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Phases of rendering a frame which are timed separately. Phases which are
+ * interleaved in output_render are accumulated over the whole frame.
+ */
+enum render_phase {
+	RENDER_PHASE_CLEAR,
+	RENDER_PHASE_LAYERS, // Layer surfaces and their popups
+	RENDER_PHASE_WORKSPACE, // Tiling tree or fullscreen container
+	RENDER_PHASE_FLOATING, // Floating containers and unmanaged surfaces
+	RENDER_PHASE_POPUPS, // View popups, seat operations and drag icons
+	RENDER_PHASE_CURSORS, // Software cursors
+	RENDER_PHASE_COMMIT, // Ending the render pass and committing the output
+	RENDER_PHASE_COUNT,
+};
+
+/**
+ * Histogram buckets are powers of two in microseconds: bucket i counts
+ * durations below 2^i us, except the last bucket which counts the rest.
+ */
+#define RENDER_HISTOGRAM_BUCKETS 16
+
+struct render_histogram {
+	uint64_t count;
+	uint64_t total_usec;
+	uint64_t max_usec;
+	uint64_t buckets[RENDER_HISTOGRAM_BUCKETS];
+};
+
+struct render_stats {
+	struct render_histogram phases[RENDER_PHASE_COUNT];
+	struct render_histogram total; // Whole frames
+	// Time between the end of a frame and the refresh it was rendered for,
+	// for frames which made it in time
+	struct render_histogram slack;
+	uint64_t missed_vblanks;
+	struct timespec reset_time;
+};
+
+/**
+ * Times the phases of a single frame.
+ */
+struct render_timer {
+	struct timespec start, last;
+	uint64_t phase_usec[RENDER_PHASE_COUNT];
+};
+
+#define ADAPTIVE_RENDER_TIME_SAMPLES 64
+
+/**
+ * Learns how long an output takes to render, or how long a client takes to
+ * commit a new frame after a frame done event, for max_render_time adaptive.
+ */
+struct adaptive_render_time {
+	uint32_t samples_usec[ADAPTIVE_RENDER_TIME_SAMPLES]; // Ring buffer
+	int nsamples, next;
+	int backoff_msec; // Added after missed frames, decays after good ones
+	int good_frames; // Since the last missed frame or backoff decay
+};
+
+void render_stats_reset(struct render_stats *stats);
+
+void render_timer_start(struct render_timer *timer);
+
+/**
+ * Attribute the time since the last call (or since the timer was started) to
+ * the given phase.
+ */
+void render_timer_phase(struct render_timer *timer, enum render_phase phase);
+
+/**
+ * Add a finished frame to the stats. The predicted refresh is the time the
+ * frame is due at in the presentation clock, or NULL if it isn't known.
+ */
+void render_stats_add_frame(struct render_stats *stats,
+		struct render_timer *timer, const struct timespec *predicted_refresh,
+		clockid_t presentation_clock);
+
+const char *render_phase_to_str(enum render_phase phase);
+
+void adaptive_render_time_reset(struct adaptive_render_time *art);
+
+/**
+ * Record how long a repaint took and whether it missed its refresh. Returns
+ * the max render time to use from now on, in milliseconds, or 0 to render
+ * right away when there isn't enough data or no time can be saved.
+ */
+int adaptive_render_time_update(struct adaptive_render_time *art,
+		uint32_t usec, bool missed, uint32_t refresh_nsec);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef _SWAY_TITLE_TEXTURE_H
+#define _SWAY_TITLE_TEXTURE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wayland-server-core.h>
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/render/wlr_texture.h>
+
+struct sway_output;
+struct border_colors;
+
+/**
+ * Rasterized titlebar text (a title or a marks string).
+ *
+ * Title textures are shared between all containers which display the same
+ * text with the same font, output scale, subpixel order and colors, so that
+ * dozens of windows with identical titles only need a single texture.
+ *
+ * Entries are reference counted. Entries which are no longer referenced stay
+ * in the cache so they can be reused, and are evicted in least recently used
+ * order once the cache grows beyond TITLE_TEXTURE_CACHE_MAX_SIZE.
+ */
+struct sway_title_texture {
+	struct wlr_texture *texture;
+
+	// Cache key
+	uint32_t hash;
+	char *text;
+	char *font;
+	bool pango_markup;
+	int height;
+	double scale;
+	enum wl_output_subpixel subpixel;
+	float background[4];
+	float foreground[4];
+	struct wlr_renderer *renderer;
+
+	size_t size; // Size of the texture in bytes
+	int refcount;
+	struct wl_list link; // Most recently used first
+};
+
+/**
+ * Maximum size of all cached title textures, in bytes. Textures which are
+ * still referenced are never evicted, so this may be exceeded temporarily.
+ */
+#define TITLE_TEXTURE_CACHE_MAX_SIZE (16 * 1024 * 1024)
+
+/**
+ * Return a reference to a texture of the given text rendered for the given
+ * output using the text and background colors of the given class. The
+ * height is in logical pixels.
+ *
+ * Returns NULL if the texture could not be created.
+ */
+struct sway_title_texture *title_texture_get(struct sway_output *output,
+		const char *text, bool pango_markup, int height,
+		struct border_colors *class);
+
+/**
+ * Drop a reference obtained from title_texture_get. Accepts NULL.
+ */
+void title_texture_unref(struct sway_title_texture *title);
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef _SWAY_TRANSACTION_H
 #define _SWAY_TRANSACTION_H
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <time.h>
 
 /**
  * Transactions enable us to perform atomic layout updates.
@@ -17,11 +20,69 @@
  * When we want to make adjustments to the layout, we change the pending state
  * in containers, mark them as dirty and call transaction_commit_dirty(). This
  * create and commits a transaction from the dirty containers.
+ *
+ * Transactions which touch disjoint sets of nodes are committed and applied
+ * independently of each other. A transaction sharing nodes with one which is
+ * still in flight waits in the queue, where it's merged with any later
+ * transactions sharing its nodes.
  */
 
 struct sway_transaction_instruction;
 struct sway_view;
 
+/**
+ * How quickly the views of a client, identified by its app_id or X11 class,
+ * acknowledge configures.
+ *
+ * Clients which keep missing the transaction timeout are marked as slow and
+ * are no longer waited for. Their views keep showing the saved buffer, scaled
+ * to the new size, until they catch up.
+ */
+struct sway_txn_client_stats {
+	char *app_id;
+	float latency_ms; // Moving average
+	uint32_t samples;
+	uint32_t timeouts;
+	uint32_t consecutive_timeouts;
+	bool slow;
+};
+
+enum transaction_trace_type {
+	TXN_TRACE_QUEUE, // Created from the dirty nodes
+	TXN_TRACE_COMMIT, // Configures sent, waiting for views
+	TXN_TRACE_CONFIGURE, // A view was sent a configure
+	TXN_TRACE_READY, // A view acknowledged its configure
+	TXN_TRACE_LATE_READY, // A slow client caught up after the apply
+	TXN_TRACE_TIMEOUT, // A view didn't acknowledge its configure in time
+	TXN_TRACE_APPLY,
+};
+
+/**
+ * An entry in the transaction trace, a ring buffer of the most recent
+ * TRANSACTION_TRACE_SIZE transaction lifecycle events.
+ */
+struct transaction_trace_event {
+	enum transaction_trace_type type;
+	struct timespec time; // CLOCK_MONOTONIC
+	uint64_t transaction; // 0 for TXN_TRACE_LATE_READY
+	size_t node_id; // 0 for events about the whole transaction
+	uint32_t serial;
+	int width, height; // For TXN_TRACE_CONFIGURE
+};
+
+#define TRANSACTION_TRACE_SIZE 4096
+
+/**
+ * Call the iterator for each event in the transaction trace, oldest first.
+ */
+void transaction_trace_for_each(
+		void (*f)(const struct transaction_trace_event *event, void *data),
+		void *data);
+
+void transaction_trace_clear(void);
+
+const char *transaction_trace_type_to_str(enum transaction_trace_type type);
+
 /**
  * Find all dirty containers, create and commit a transaction containing them,
  * and unmark them as dirty.
@@ -45,4 +106,11 @@ void transaction_notify_view_ready_by_serial(struct sway_view *view,
 void transaction_notify_view_ready_by_size(struct sway_view *view,
 		int width, int height);
 
+/**
+ * Get the configure latency statistics of the client owning the view, or NULL
+ * if none have been recorded yet.
+ */
+const struct sway_txn_client_stats *transaction_get_client_stats(
+		struct sway_view *view);
+
 #endif
@@ -9,8 +9,42 @@ json_object *ipc_json_get_version(void);
 json_object *ipc_json_get_binding_mode(void);
 
 json_object *ipc_json_describe_disabled_output(struct sway_output *o);
+json_object *ipc_json_describe_render_stats(struct sway_output *o);
+json_object *ipc_json_describe_transaction_trace(void);
 json_object *ipc_json_describe_node(struct sway_node *node);
 json_object *ipc_json_describe_node_recursive(struct sway_node *node);
+
+/**
+ * Describe a node without its focus state or any property which changes
+ * without the node being marked dirty, listing its children as arrays of
+ * node IDs instead of describing them.
+ */
+json_object *ipc_json_describe_node_flat(struct sway_node *node);
+
+/**
+ * The parts of the tree to describe in a get_tree reply.
+ */
+struct ipc_tree_query {
+	// Nodes to describe as an array of subtrees, or NULL for the whole tree
+	list_t *nodes;
+	// Levels of children to describe, or -1 for no limit
+	int depth;
+	// Names of the fields to describe for each node, or NULL for all of them
+	list_t *fields;
+};
+
+/**
+ * Serialize the tree as returned by get_tree, without building it as a
+ * json-c object first. The returned string is owned by ipc-json and is only
+ * valid until the next call. Returns NULL on allocation failure.
+ */
+const char *ipc_json_serialize_tree(const struct ipc_tree_query *query,
+		size_t *length);
+/**
+ * Describe the tree as returned by get_tree as a json-c object, for clients
+ * which don't use JSON text.
+ */
+json_object *ipc_json_describe_tree(const struct ipc_tree_query *query);
 json_object *ipc_json_describe_input(struct sway_input_device *device);
 json_object *ipc_json_describe_seat(struct sway_seat *seat);
 json_object *ipc_json_describe_bar_config(struct bar_config *bar);
@@ -22,4 +22,20 @@ void ipc_event_shutdown(const char *reason);
 void ipc_event_binding(struct sway_binding *binding);
 void ipc_event_input(const char *change, struct sway_input_device *device);
 
+/**
+ * Record that a node changed, so it is described in the next tree_delta
+ * event. Does nothing if nobody is subscribed to tree_delta.
+ */
+void ipc_tree_delta_add(struct sway_node *node);
+
+/**
+ * Send a tree_delta event for the nodes changed since the last one, if any.
+ */
+void ipc_event_tree_delta(void);
+
+/**
+ * Drop the tree_delta state of a node which is being freed.
+ */
+void ipc_tree_delta_forget(struct sway_node *node);
+
 #endif
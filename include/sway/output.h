@@ -1,11 +1,13 @@
 #ifndef _SWAY_OUTPUT_H
 #define _SWAY_OUTPUT_H
+#include <stdint.h>
 #include <time.h>
 #include <unistd.h>
 #include <wayland-server-core.h>
 #include <wlr/types/wlr_box.h>
 #include <wlr/types/wlr_output.h>
 #include "config.h"
+#include "sway/desktop/render_stats.h"
 #include "sway/tree/node.h"
 #include "sway/tree/view.h"
 
@@ -17,6 +19,27 @@ struct sway_output_state {
 	struct sway_workspace *active_workspace;
 };
 
+/**
+ * Outcome of trying to scan out a fullscreen view directly, or the reason
+ * the output had to be composited instead.
+ */
+enum sway_scanout_status {
+	SCANOUT_NOT_FULLSCREEN, // No fullscreen view to scan out
+	SCANOUT_OK,
+	SCANOUT_SAVED_BUFFERS, // The view is waiting for a transaction
+	SCANOUT_TRANSIENT, // A transient floating view is visible
+	SCANOUT_UNMANAGED, // An unmanaged X11 surface is visible
+	SCANOUT_OVERLAY_LAYER, // An overlay layer surface is visible
+	SCANOUT_DRAG_ICON, // A drag icon is visible
+	SCANOUT_NO_BUFFER, // The view has no buffer
+	SCANOUT_SURFACES, // Subsurfaces or popups are visible
+	SCANOUT_GEOMETRY, // The view doesn't cover the whole output
+	SCANOUT_TRANSFORM, // Scale or transform differ from the output
+	SCANOUT_COMMIT_FAILED, // The backend refused the buffer
+};
+
+#define SCANOUT_STATUS_COUNT (SCANOUT_COMMIT_FAILED + 1)
+
 struct sway_output {
 	struct sway_node node;
 	struct wlr_output *wlr_output;
@@ -56,7 +79,18 @@ struct sway_output {
 	struct timespec last_presentation;
 	uint32_t refresh_nsec;
 	int max_render_time; // In milliseconds
+	bool max_render_time_adaptive; // max_render_time is learned
+	struct adaptive_render_time adaptive_render_time;
 	struct wl_event_source *repaint_timer;
+
+	enum sway_scanout_status scanout_status; // Of the last frame
+	struct {
+		uint64_t scanned_out; // Frames presented via direct scanout
+		uint64_t composited; // Frames rendered by sway
+		uint64_t rejected[SCANOUT_STATUS_COUNT]; // enum sway_scanout_status
+	} scanout_stats;
+
+	struct render_stats render_stats;
 };
 
 struct sway_output *output_create(struct wlr_output *wlr_output);
@@ -106,6 +140,13 @@ bool output_has_opaque_overlay_layer_surface(struct sway_output *output);
 
 struct sway_workspace *output_get_active_workspace(struct sway_output *output);
 
+/**
+ * Rasterize the titlebar textures which will be displayed in the next frame.
+ * Textures cannot be created while rendering, so this must be called before
+ * the output is attached for rendering.
+ */
+void output_render_prepare(struct sway_output *output);
+
 void output_render(struct sway_output *output, struct timespec *when,
 	pixman_region32_t *damage);
 
@@ -143,6 +184,8 @@ void output_drag_icons_for_each_surface(struct sway_output *output,
 	struct wl_list *drag_icons, sway_surface_iterator_func_t iterator,
 	void *user_data);
 
+const char *scanout_status_to_str(enum sway_scanout_status status);
+
 void output_for_each_workspace(struct sway_output *output,
 		void (*f)(struct sway_workspace *ws, void *data), void *data);
 
@@ -1,6 +1,7 @@
 #ifndef _SWAY_SERVER_H
 #define _SWAY_SERVER_H
 #include <stdbool.h>
+#include <time.h>
 #include <wayland-server-core.h>
 #include <wlr/backend.h>
 #include <wlr/backend/session.h>
@@ -88,6 +89,13 @@ struct sway_server {
 	size_t txn_timeout_ms;
 	list_t *transactions;
 	list_t *dirty_nodes;
+	list_t *txn_client_stats; // struct sway_txn_client_stats *
+
+	list_t *pending_titles; // struct sway_view *
+	struct wl_event_source *title_update_timer;
+	struct timespec last_title_update;
+
+	struct wl_event_source *occluded_frame_timer;
 };
 
 extern struct sway_server server;
@@ -96,6 +104,7 @@ struct sway_debug {
 	bool noatomic;         // Ignore atomic layout updates
 	bool txn_timings;      // Log verbose messages about transactions
 	bool txn_wait;         // Always wait for the timeout before applying
+	bool noquarantine;     // Always wait for slow clients
 
 	enum {
 		DAMAGE_DEFAULT,    // Default behaviour
@@ -1,5 +1,7 @@
 #ifndef _SWAY_SURFACE_H
 #define _SWAY_SURFACE_H
+#include <stdbool.h>
+#include <time.h>
 #include <wlr/types/wlr_surface.h>
 
 struct sway_surface {
@@ -13,6 +15,15 @@ struct sway_surface {
 	 * function that issues a frame done callback to this surface.
 	 */
 	struct wl_event_source *frame_done_timer;
+
+	/**
+	 * When the last frame done event was sent, and when the output it was
+	 * sent for is going to be composited next. Used to learn how long the
+	 * client takes to commit a new frame for max_render_time adaptive.
+	 */
+	struct timespec frame_done_time;
+	struct timespec frame_deadline;
+	bool frame_done_pending; // Sent, but no commit has been seen since
 };
 
 #endif
@@ -9,6 +9,8 @@
 
 struct sway_view;
 struct sway_seat;
+struct sway_title_texture;
+struct border_colors;
 
 enum sway_container_layout {
 	L_NONE,
@@ -38,6 +40,32 @@ struct sway_view;
 
 enum wlr_direction;
 
+enum sway_container_edge {
+	EDGE_TOP,
+	EDGE_BOTTOM,
+	EDGE_LEFT,
+	EDGE_RIGHT,
+};
+
+/**
+ * Geometry of a container's titlebar and borders in layout coordinates.
+ *
+ * This is derived from the current state when a transaction is applied, so
+ * the renderer doesn't need to work it out again on every frame. Boxes with
+ * a zero size are not drawn.
+ */
+struct sway_container_decorations {
+	bool has_titlebar;
+	struct wlr_box titlebar; // Outer box of the titlebar, including borders
+	struct wlr_box titlebar_edges[4]; // enum sway_container_edge
+	struct wlr_box titlebar_background; // Inside the titlebar border
+	struct wlr_box titlebar_padding[2]; // Left and right of the text area
+
+	struct wlr_box borders[4]; // enum sway_container_edge
+	bool right_indicator, bottom_indicator;
+	struct wlr_box border_bounds; // Union of the borders
+};
+
 struct sway_container_state {
 	// Container properties
 	enum sway_container_layout layout;
@@ -62,6 +90,8 @@ struct sway_container_state {
 
 	double content_x, content_y;
 	double content_width, content_height;
+
+	struct sway_container_decorations decorations;
 };
 
 struct sway_container {
@@ -134,18 +164,19 @@ struct sway_container {
 
 	float alpha;
 
-	struct wlr_texture *title_focused;
-	struct wlr_texture *title_focused_inactive;
-	struct wlr_texture *title_unfocused;
-	struct wlr_texture *title_urgent;
+	struct sway_title_texture *title_focused;
+	struct sway_title_texture *title_focused_inactive;
+	struct sway_title_texture *title_unfocused;
+	struct sway_title_texture *title_urgent;
 	size_t title_height;
 	size_t title_baseline;
 
 	list_t *marks; // char *
-	struct wlr_texture *marks_focused;
-	struct wlr_texture *marks_focused_inactive;
-	struct wlr_texture *marks_unfocused;
-	struct wlr_texture *marks_urgent;
+	char *formatted_marks; // The visible marks displayed in the title bar
+	struct sway_title_texture *marks_focused;
+	struct sway_title_texture *marks_focused_inactive;
+	struct sway_title_texture *marks_unfocused;
+	struct sway_title_texture *marks_urgent;
 
 	struct {
 		struct wl_signal destroy;
@@ -195,8 +226,34 @@ void container_reap_empty(struct sway_container *con);
 
 struct sway_container *container_flatten(struct sway_container *container);
 
+/**
+ * Drop the container's title textures, so they are rasterized again with the
+ * current title the next time they are displayed.
+ */
 void container_update_title_textures(struct sway_container *container);
 
+/**
+ * Rasterize the title and marks textures for the given border colors class,
+ * if this hasn't been done already. Textures are created lazily so that only
+ * the variants which are actually displayed are rendered.
+ */
+void container_prepare_title_textures(struct sway_container *container,
+		struct border_colors *class);
+
+/**
+ * Return the title texture for the given border colors class, or NULL if it
+ * hasn't been prepared.
+ */
+struct sway_title_texture *container_get_title_texture(
+		struct sway_container *container, struct border_colors *class);
+
+/**
+ * Return the marks texture for the given border colors class, or NULL if it
+ * hasn't been prepared or marks are hidden.
+ */
+struct sway_title_texture *container_get_marks_texture(
+		struct sway_container *container, struct border_colors *class);
+
 /**
  * Calculate the container's title_height property.
  */
@@ -312,6 +369,12 @@ int container_sibling_index(struct sway_container *child);
 
 list_t *container_get_current_siblings(struct sway_container *container);
 
+/**
+ * Recompute the decoration geometry of the container's current state. This
+ * depends on the current state of the container's parent and siblings.
+ */
+void container_update_decorations(struct sway_container *con);
+
 void container_handle_fullscreen_reparent(struct sway_container *con);
 
 void container_add_child(struct sway_container *parent,
@@ -359,6 +422,10 @@ bool container_has_mark(struct sway_container *container, char *mark);
 
 void container_add_mark(struct sway_container *container, char *mark);
 
+/**
+ * Reformat the container's visible marks and drop its marks textures, so they
+ * are rasterized again the next time they are displayed.
+ */
 void container_update_marks_textures(struct sway_container *container);
 
 void container_raise_floating(struct sway_container *con);
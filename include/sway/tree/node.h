@@ -1,6 +1,7 @@
 #ifndef _SWAY_NODE_H
 #define _SWAY_NODE_H
 #include <stdbool.h>
+#include <stdint.h>
 #include "list.h"
 
 #define MIN_SANE_W 100
@@ -39,10 +40,25 @@ struct sway_node {
 	size_t ntxnrefs;
 	bool destroying;
 
+	// Used by the transaction queue to find transactions sharing nodes
+	uint32_t txn_mark;
+
 	// If true, indicates that the container has pending state that differs from
 	// the current.
 	bool dirty;
 
+	// Serialized get_tree description of the node itself, without children
+	// or focus state, and the same as an object for queries selecting
+	// fields. Dropped whenever the node changes.
+	char *ipc_json;
+	size_t ipc_json_len;
+	struct json_object *ipc_json_object;
+
+	// Description last sent in a tree_delta event, valid if the epoch matches
+	struct json_object *ipc_delta_state;
+	uint32_t ipc_delta_epoch;
+	bool ipc_delta_pending;
+
 	struct {
 		struct wl_signal destroy;
 	} events;
@@ -58,6 +74,13 @@ const char *node_type_to_str(enum sway_node_type type);
  */
 void node_set_dirty(struct sway_node *node);
 
+/**
+ * Drop the cached get_tree description of the node. This must be called
+ * whenever anything included in the description changes without the node
+ * being marked dirty.
+ */
+void node_invalidate_ipc_json(struct sway_node *node);
+
 bool node_is_view(struct sway_node *node);
 
 char *node_get_name(struct sway_node *node);
@@ -74,4 +97,19 @@ list_t *node_get_children(struct sway_node *node);
 
 bool node_has_ancestor(struct sway_node *node, struct sway_node *ancestor);
 
+/**
+ * The lists of children in the current state of nodes and in transaction
+ * instructions are read-only and reference counted, so that states with the
+ * same children can share a single list.
+ *
+ * Return a reference to a list holding the given items. If shared (which may
+ * be NULL) already holds exactly these items, it's reused instead of copying.
+ */
+list_t *node_state_list_share(list_t *shared, list_t *items);
+
+/**
+ * Drop a reference to a list returned by node_state_list_share. Accepts NULL.
+ */
+void node_state_list_unref(list_t *list);
+
 #endif
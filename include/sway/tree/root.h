@@ -35,6 +35,9 @@ struct sway_root {
 
 	struct sway_container *fullscreen_global;
 
+	// Generation of the last tree_delta event
+	uint64_t generation;
+
 	struct {
 		struct wl_signal new_node;
 	} events;
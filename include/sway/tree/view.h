@@ -6,6 +6,7 @@
 #if HAVE_XWAYLAND
 #include <wlr/xwayland.h>
 #endif
+#include "sway/desktop/render_stats.h"
 #include "sway/input/input-manager.h"
 #include "sway/input/seat.h"
 
@@ -80,6 +81,7 @@ struct sway_view {
 	int natural_width, natural_height;
 
 	char *title_format;
+	bool title_pending; // In server.pending_titles
 
 	bool using_csd;
 
@@ -89,6 +91,16 @@ struct sway_view {
 
 	struct wl_list saved_buffers; // sway_saved_buffer::link
 
+	// A configure from an applied transaction which the client hasn't
+	// acknowledged yet, because it's slow and wasn't waited for. The saved
+	// buffer is shown, scaled to the container, until it does.
+	struct {
+		bool pending;
+		uint32_t serial;
+		int width, height;
+		struct timespec time; // When the configure was sent
+	} late_configure;
+
 	// The geometry for whatever the client is committing, regardless of
 	// transaction state. Updated on every commit.
 	struct wlr_box geometry;
@@ -122,6 +134,8 @@ struct sway_view {
 	struct wl_listener surface_new_subsurface;
 
 	int max_render_time; // In milliseconds
+	bool max_render_time_adaptive;
+	struct adaptive_render_time adaptive_render_time;
 
 	enum seat_config_shortcuts_inhibit shortcuts_inhibit;
 };
@@ -287,6 +301,12 @@ void view_close_popups(struct sway_view *view);
 
 void view_damage_from(struct sway_view *view);
 
+/**
+ * Called when the view's main surface commits. Feeds the time since the last
+ * frame done event into the learned max_render_time of adaptive views.
+ */
+void view_record_commit_latency(struct sway_view *view);
+
 /**
  * Iterate all surfaces of a view (toplevels + popups).
  */
@@ -337,6 +357,26 @@ struct sway_view *view_from_wlr_surface(struct wlr_surface *surface);
  */
 void view_update_title(struct sway_view *view, bool force);
 
+/**
+ * Queue a title update for a view whose title property has changed. Queued
+ * titles are applied together on the next output frame, but no more often
+ * than the configured title_update_interval, so that clients which retitle
+ * rapidly only cause one update and one IPC event per frame.
+ */
+void view_queue_title_update(struct sway_view *view);
+
+/**
+ * Apply queued title updates if the title_update_interval has elapsed.
+ * Called once per output frame.
+ */
+void view_update_pending_titles(void);
+
+/**
+ * Arm the timer which sends frame done events at the occluded_frame_rate to
+ * views which are hidden or covered, and so don't get them on output frames.
+ */
+void view_schedule_occluded_frames(void);
+
 /**
  * Run any criteria that match the view and haven't been run on this view
  * before.
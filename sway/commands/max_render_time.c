@@ -9,8 +9,12 @@ struct cmd_results *cmd_max_render_time(int argc, char **argv) {
 	}
 
 	int max_render_time;
+	bool adaptive = false;
 	if (!strcmp(*argv, "off")) {
 		max_render_time = 0;
+	} else if (!strcmp(*argv, "adaptive")) {
+		max_render_time = 0;
+		adaptive = true;
 	} else {
 		char *end;
 		max_render_time = strtol(*argv, &end, 10);
@@ -26,7 +30,14 @@ struct cmd_results *cmd_max_render_time(int argc, char **argv) {
 	}
 
 	struct sway_view *view = container->view;
-	view->max_render_time = max_render_time;
+	if (!adaptive) {
+		view->max_render_time = max_render_time;
+	} else if (!view->max_render_time_adaptive) {
+		// Start from scratch, render right away until enough is known
+		adaptive_render_time_reset(&view->adaptive_render_time);
+		view->max_render_time = 0;
+	}
+	view->max_render_time_adaptive = adaptive;
 
 	return cmd_results_new(CMD_SUCCESS, NULL);
 }
@@ -0,0 +1,31 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sway/commands.h"
+#include "sway/config.h"
+#include "sway/tree/view.h"
+
+struct cmd_results *cmd_occluded_frame_rate(int argc, char **argv) {
+	struct cmd_results *error = NULL;
+	if ((error = checkarg(argc, "occluded_frame_rate", EXPECTED_EQUAL_TO, 1))) {
+		return error;
+	}
+
+	int value;
+	if (strcmp(argv[0], "off") == 0) {
+		value = OCCLUDED_FRAME_RATE_OFF;
+	} else if (strcmp(argv[0], "none") == 0) {
+		value = 0;
+	} else {
+		char *inv;
+		value = strtol(argv[0], &inv, 10);
+		if (*inv != '\0' || value <= 0 || value > 1000) {
+			return cmd_results_new(CMD_INVALID,
+					"Expected 'off', 'none' or a frame rate between 1 and 1000");
+		}
+	}
+
+	config->occluded_frame_rate = value;
+	view_schedule_occluded_frames();
+
+	return cmd_results_new(CMD_SUCCESS, NULL);
+}
@@ -24,6 +24,7 @@ struct cmd_results *cmd_sticky(int argc, char **argv) {
 	};
 
 	container->is_sticky = parse_boolean(argv[0], container->is_sticky);
+	node_invalidate_ipc_json(&container->node);
 
 	if (container->is_sticky && container_is_floating_or_child(container) &&
 			!container_is_scratchpad_hidden(container)) {
@@ -0,0 +1,20 @@
+#include <stdlib.h>
+#include "sway/commands.h"
+#include "sway/config.h"
+
+struct cmd_results *cmd_title_update_interval(int argc, char **argv) {
+	struct cmd_results *error = NULL;
+	if ((error = checkarg(argc, "title_update_interval", EXPECTED_EQUAL_TO, 1))) {
+		return error;
+	}
+
+	char *inv;
+	int value = strtol(argv[0], &inv, 10);
+	if (*inv != '\0' || value < 0) {
+		return cmd_results_new(CMD_INVALID, "Invalid interval specified");
+	}
+
+	config->title_update_interval = value;
+
+	return cmd_results_new(CMD_SUCCESS, NULL);
+}
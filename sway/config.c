@@ -12,6 +12,7 @@
 #include <libinput.h>
 #include <limits.h>
 #include <dirent.h>
+#include <string.h>
 #include <strings.h>
 #include <linux/input-event-codes.h>
 #include <wlr/types/wlr_output.h>
@@ -264,6 +265,8 @@ static void config_defaults(struct sway_config *config) {
 	config->reading = false;
 	config->show_marks = true;
 	config->title_align = ALIGN_LEFT;
+	config->title_update_interval = 0;
+	config->occluded_frame_rate = OCCLUDED_FRAME_RATE_OFF;
 	config->tiling_drag = true;
 	config->tiling_drag_threshold = 9;
 
@@ -960,31 +963,82 @@ int workspace_output_cmp_workspace(const void *a, const void *b) {
 	return lenient_strcmp(wsa->workspace, wsb->workspace);
 }
 
-static void find_font_height_iterator(struct sway_container *con, void *data) {
-	size_t amount_below_baseline = con->title_height - con->title_baseline;
-	size_t extended_height = config->font_baseline + amount_below_baseline;
-	if (extended_height > config->font_height) {
-		config->font_height = extended_height;
+/**
+ * A counted histogram of title metrics, used to keep track of the maximum
+ * over all containers without walking the tree. Zero values are not counted
+ * as they never raise the maximum.
+ */
+struct title_metric_histogram {
+	size_t *counts;
+	size_t capacity;
+	size_t max;
+};
+
+// These persist across config reloads along with the containers.
+static struct title_metric_histogram title_baselines;
+static struct title_metric_histogram title_descents;
+
+static void histogram_add(struct title_metric_histogram *histogram,
+		size_t value) {
+	if (value == 0) {
+		return;
+	}
+	if (value >= histogram->capacity) {
+		size_t capacity = histogram->capacity ? histogram->capacity : 32;
+		while (value >= capacity) {
+			capacity *= 2;
+		}
+		size_t *counts = realloc(histogram->counts, capacity * sizeof(size_t));
+		if (!sway_assert(counts, "Unable to allocate title metrics")) {
+			return;
+		}
+		memset(counts + histogram->capacity, 0,
+				(capacity - histogram->capacity) * sizeof(size_t));
+		histogram->counts = counts;
+		histogram->capacity = capacity;
+	}
+	histogram->counts[value]++;
+	if (value > histogram->max) {
+		histogram->max = value;
 	}
 }
 
-static void find_baseline_iterator(struct sway_container *con, void *data) {
-	bool *recalculate = data;
-	if (*recalculate) {
-		container_calculate_title_height(con);
+static void histogram_remove(struct title_metric_histogram *histogram,
+		size_t value) {
+	if (value == 0 || value >= histogram->capacity ||
+			histogram->counts[value] == 0) {
+		return;
 	}
-	if (con->title_baseline > config->font_baseline) {
-		config->font_baseline = con->title_baseline;
+	histogram->counts[value]--;
+	while (histogram->max > 0 && histogram->counts[histogram->max] == 0) {
+		histogram->max--;
 	}
 }
 
+void config_add_title_metrics(size_t height, size_t baseline) {
+	histogram_add(&title_baselines, baseline);
+	histogram_add(&title_descents, height - baseline);
+}
+
+void config_remove_title_metrics(size_t height, size_t baseline) {
+	histogram_remove(&title_baselines, baseline);
+	histogram_remove(&title_descents, height - baseline);
+}
+
+static void recalculate_title_height_iterator(struct sway_container *con,
+		void *data) {
+	container_calculate_title_height(con);
+}
+
 void config_update_font_height(bool recalculate) {
 	size_t prev_max_height = config->font_height;
-	config->font_height = 0;
-	config->font_baseline = 0;
 
-	root_for_each_container(find_baseline_iterator, &recalculate);
-	root_for_each_container(find_font_height_iterator, NULL);
+	if (recalculate) {
+		root_for_each_container(recalculate_title_height_iterator, NULL);
+	}
+
+	config->font_baseline = title_baselines.max;
+	config->font_height = title_baselines.max + title_descents.max;
 
 	if (config->font_height != prev_max_height) {
 		arrange_root();
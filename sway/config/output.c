@@ -470,10 +470,18 @@ bool apply_output_config(struct output_config *oc, struct sway_output *output) {
 		output_enable(output);
 	}
 
-	if (oc && oc->max_render_time >= 0) {
+	if (oc && oc->max_render_time == MAX_RENDER_TIME_ADAPTIVE) {
+		sway_log(SWAY_DEBUG, "Set %s max render time to adaptive", oc->name);
+		if (!output->max_render_time_adaptive) {
+			adaptive_render_time_reset(&output->adaptive_render_time);
+			output->max_render_time = 0;
+		}
+		output->max_render_time_adaptive = true;
+	} else if (oc && oc->max_render_time >= 0) {
 		sway_log(SWAY_DEBUG, "Set %s max render time to %d",
 			oc->name, oc->max_render_time);
 		output->max_render_time = oc->max_render_time;
+		output->max_render_time_adaptive = false;
 	}
 
 	// Reconfigure all devices, since input config may have been applied before
@@ -0,0 +1,121 @@
+#include <math.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_surface.h>
+#include <wlr/util/region.h>
+#include "sway/config.h"
+#include "sway/desktop/opaque_region.h"
+#include "sway/layers.h"
+#include "sway/output.h"
+#include "sway/tree/container.h"
+#include "sway/tree/root.h"
+#include "sway/tree/view.h"
+#include "sway/tree/workspace.h"
+
+bool opaque_region_usable(struct sway_output *output) {
+	float scale = output->wlr_output->scale;
+	return scale == floor(scale);
+}
+
+/**
+ * Add the opaque region of a surface at the given output-local position.
+ */
+static void add_surface(struct sway_output *output,
+		pixman_region32_t *occluded, struct wlr_surface *surface,
+		int ox, int oy) {
+	if (!pixman_region32_not_empty(&surface->opaque_region)) {
+		return;
+	}
+	pixman_region32_t opaque;
+	pixman_region32_init(&opaque);
+	pixman_region32_copy(&opaque, &surface->opaque_region);
+	pixman_region32_translate(&opaque, ox, oy);
+	wlr_region_scale(&opaque, &opaque, output->wlr_output->scale);
+	pixman_region32_union(occluded, occluded, &opaque);
+	pixman_region32_fini(&opaque);
+}
+
+static void add_view(struct sway_output *output,
+		pixman_region32_t *occluded, struct sway_container *con) {
+	struct sway_view *view = con->view;
+	if (!view->surface || con->alpha < 1.0f ||
+			!wl_list_empty(&view->saved_buffers)) {
+		return;
+	}
+	add_surface(output, occluded, view->surface,
+		con->surface_x - output->lx - view->geometry.x,
+		con->surface_y - output->ly - view->geometry.y);
+}
+
+/**
+ * Add the opaque regions of the given children which will be displayed,
+ * mirroring the traversal done by render_containers.
+ */
+static void add_children(struct sway_output *output,
+		pixman_region32_t *occluded, enum sway_container_layout layout,
+		list_t *children, struct sway_container *active_child) {
+	bool linear = layout == L_NONE || layout == L_HORIZ || layout == L_VERT;
+	if (config->hide_lone_tab && children->length == 1) {
+		struct sway_container *child = children->items[0];
+		linear = linear || child->view;
+	}
+
+	for (int i = 0; i < children->length; ++i) {
+		struct sway_container *child = children->items[i];
+		if (!linear && child != active_child) {
+			continue;
+		}
+		if (child->view) {
+			add_view(output, occluded, child);
+		} else {
+			add_children(output, occluded, child->current.layout,
+				child->current.children,
+				child->current.focused_inactive_child);
+		}
+	}
+}
+
+void opaque_region_add_top_layer(struct sway_output *output,
+		pixman_region32_t *occluded) {
+	struct sway_layer_surface *layer_surface;
+	wl_list_for_each(layer_surface,
+			&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_TOP], link) {
+		if (layer_surface->layer_surface->mapped) {
+			add_surface(output, occluded,
+				layer_surface->layer_surface->surface,
+				layer_surface->geo.x, layer_surface->geo.y);
+		}
+	}
+}
+
+void opaque_region_add_floating(struct sway_output *output,
+		pixman_region32_t *occluded) {
+	for (int i = 0; i < root->outputs->length; ++i) {
+		struct sway_output *other = root->outputs->items[i];
+		for (int j = 0; j < other->current.workspaces->length; ++j) {
+			struct sway_workspace *ws = other->current.workspaces->items[j];
+			if (!workspace_is_visible(ws)) {
+				continue;
+			}
+			for (int k = 0; k < ws->current.floating->length; ++k) {
+				struct sway_container *floater = ws->current.floating->items[k];
+				if (floater->fullscreen_mode != FULLSCREEN_NONE) {
+					continue;
+				}
+				if (floater->view) {
+					add_view(output, occluded, floater);
+				} else {
+					add_children(output, occluded, floater->current.layout,
+						floater->current.children,
+						floater->current.focused_inactive_child);
+				}
+			}
+		}
+	}
+}
+
+void opaque_region_add_tiling(struct sway_output *output,
+		struct sway_workspace *workspace, pixman_region32_t *occluded) {
+	add_children(output, occluded, workspace->current.layout,
+		workspace->current.tiling,
+		workspace->current.focused_inactive_child);
+}
@@ -17,6 +17,7 @@
 #include "config.h"
 #include "log.h"
 #include "sway/config.h"
+#include "sway/desktop/opaque_region.h"
 #include "sway/desktop/transaction.h"
 #include "sway/input/input-manager.h"
 #include "sway/input/seat.h"
@@ -461,8 +462,70 @@ bool output_has_opaque_overlay_layer_surface(struct sway_output *output) {
 struct send_frame_done_data {
 	struct timespec when;
 	int msec_until_refresh;
+	struct timespec deadline; // When the output will be composited next
+
+	// Output-buffer-local areas covered by opaque surfaces stacked above
+	// floating and tiling views
+	float scale;
+	pixman_region32_t occluded_floating;
+	pixman_region32_t occluded_tiling;
+
+	struct sway_view *view; // Last view seen by the iterator
+	bool view_has_popups;
 };
 
+/**
+ * Collect the areas of the output where tiling and floating views can't be
+ * seen, the same way the renderer does to skip drawing them.
+ */
+static void get_occluded_regions(struct sway_output *output,
+		struct send_frame_done_data *data) {
+	if (!opaque_region_usable(output)) {
+		return;
+	}
+	opaque_region_add_top_layer(output, &data->occluded_floating);
+	pixman_region32_copy(&data->occluded_tiling, &data->occluded_floating);
+	opaque_region_add_floating(output, &data->occluded_tiling);
+}
+
+static void count_popups_iterator(struct wlr_surface *surface,
+		int sx, int sy, void *data) {
+	bool *has_popups = data;
+	*has_popups = true;
+}
+
+/**
+ * Whether a view's surface is entirely hidden behind opaque surfaces. Views
+ * with popups are never considered occluded, since popups are drawn above
+ * everything else.
+ */
+static bool surface_is_occluded(struct send_frame_done_data *data,
+		struct sway_view *view, struct wlr_box *box) {
+	if (view != data->view) {
+		data->view = view;
+		data->view_has_popups = false;
+		view_for_each_popup(view, count_popups_iterator,
+			&data->view_has_popups);
+	}
+	if (data->view_has_popups || !view->container) {
+		return false;
+	}
+
+	pixman_region32_t *occluded =
+		container_is_floating_or_child(view->container) ?
+		&data->occluded_floating : &data->occluded_tiling;
+	struct wlr_box scaled = *box;
+	scale_box(&scaled, data->scale);
+	pixman_box32_t surface_box = {
+		.x1 = scaled.x,
+		.y1 = scaled.y,
+		.x2 = scaled.x + scaled.width,
+		.y2 = scaled.y + scaled.height,
+	};
+	return pixman_region32_contains_rectangle(occluded, &surface_box) ==
+		PIXMAN_REGION_IN;
+}
+
 static void send_frame_done_iterator(struct sway_output *output, struct sway_view *view,
 		struct wlr_surface *surface, struct wlr_box *box, float rotation,
 		void *user_data) {
@@ -473,86 +536,198 @@ static void send_frame_done_iterator(struct sway_output *output, struct sway_vie
 
 	struct send_frame_done_data *data = user_data;
 
+	if (view != NULL && surface_is_occluded(data, view, box)) {
+		// Left to the occluded_frame_rate timer
+		return;
+	}
+
 	int delay = data->msec_until_refresh - output->max_render_time
 			- view_max_render_time;
 
+	struct sway_surface *sway_surface = surface->data;
+	if (sway_surface) {
+		sway_surface->frame_deadline = data->deadline;
+	}
+
 	if (output->max_render_time == 0 || view_max_render_time == 0 || delay < 1) {
+		// Only a surface which asked for a frame is racing the repaint
+		if (sway_surface &&
+				!wl_list_empty(&surface->current.frame_callback_list)) {
+			sway_surface->frame_done_time = data->when;
+			sway_surface->frame_done_pending = true;
+		}
 		wlr_surface_send_frame_done(surface, &data->when);
 	} else {
-		struct sway_surface *sway_surface = surface->data;
 		wl_event_source_timer_update(sway_surface->frame_done_timer, delay);
 	}
 }
 
 static void send_frame_done(struct sway_output *output, struct send_frame_done_data *data) {
+	pixman_region32_init(&data->occluded_floating);
+	pixman_region32_init(&data->occluded_tiling);
+
+	data->scale = output->wlr_output->scale;
+
+	// Everything below a fullscreen view is skipped by output_for_each_surface
+	struct sway_workspace *workspace = output_get_active_workspace(output);
+	if (config->occluded_frame_rate != OCCLUDED_FRAME_RATE_OFF &&
+			!root->fullscreen_global && workspace &&
+			!workspace->current.fullscreen) {
+		get_occluded_regions(output, data);
+	}
+
 	output_for_each_surface(output, send_frame_done_iterator, data);
+
+	pixman_region32_fini(&data->occluded_floating);
+	pixman_region32_fini(&data->occluded_tiling);
 }
 
-static void count_surface_iterator(struct sway_output *output, struct sway_view *view,
-		struct wlr_surface *surface, struct wlr_box *_box, float rotation,
-		void *data) {
-	size_t *n = data;
-	(*n)++;
+const char *scanout_status_to_str(enum sway_scanout_status status) {
+	switch (status) {
+	case SCANOUT_NOT_FULLSCREEN:
+		return "not_fullscreen";
+	case SCANOUT_OK:
+		return "scanned_out";
+	case SCANOUT_SAVED_BUFFERS:
+		return "saved_buffers";
+	case SCANOUT_TRANSIENT:
+		return "transient";
+	case SCANOUT_UNMANAGED:
+		return "unmanaged";
+	case SCANOUT_OVERLAY_LAYER:
+		return "overlay_layer";
+	case SCANOUT_DRAG_ICON:
+		return "drag_icon";
+	case SCANOUT_NO_BUFFER:
+		return "no_buffer";
+	case SCANOUT_SURFACES:
+		return "surface_count";
+	case SCANOUT_GEOMETRY:
+		return "geometry_mismatch";
+	case SCANOUT_TRANSFORM:
+		return "transform_mismatch";
+	case SCANOUT_COMMIT_FAILED:
+		return "commit_failed";
+	}
+	return "unknown";
 }
 
-static bool scan_out_fullscreen_view(struct sway_output *output,
-		struct sway_view *view) {
+struct scanout_visibility_data {
+	struct wlr_surface *main_surface;
+	struct wlr_box main_box; // Zero-sized if not visible on the output
+	size_t n_visible; // Visible surfaces other than the main surface
+};
+
+/**
+ * Surface iterators only visit surfaces which have a buffer and intersect the
+ * output, so anything unmapped or off-screen doesn't prevent scanning out.
+ */
+static void scanout_visibility_iterator(struct sway_output *output,
+		struct sway_view *view, struct wlr_surface *surface,
+		struct wlr_box *box, float rotation, void *_data) {
+	struct scanout_visibility_data *data = _data;
+	if (surface == data->main_surface) {
+		data->main_box = *box;
+	} else if (box->width > 0 && box->height > 0) {
+		data->n_visible++;
+	}
+}
+
+static enum sway_scanout_status scan_out_fullscreen_view(
+		struct sway_output *output, struct sway_view *view) {
 	struct wlr_output *wlr_output = output->wlr_output;
 	struct sway_workspace *workspace = output->current.active_workspace;
 	if (!sway_assert(workspace, "Expected an active workspace")) {
-		return false;
+		return SCANOUT_NOT_FULLSCREEN;
 	}
 
 	if (!wl_list_empty(&view->saved_buffers)) {
-		return false;
+		return SCANOUT_SAVED_BUFFERS;
 	}
 
+	struct scanout_visibility_data data = {0};
+
 	for (int i = 0; i < workspace->current.floating->length; ++i) {
 		struct sway_container *floater =
 			workspace->current.floating->items[i];
-		if (container_is_transient_for(floater, view->container)) {
-			return false;
+		if (floater->view &&
+				container_is_transient_for(floater, view->container)) {
+			output_view_for_each_surface(output, floater->view,
+				scanout_visibility_iterator, &data);
 		}
 	}
+	if (data.n_visible > 0) {
+		return SCANOUT_TRANSIENT;
+	}
 
 #if HAVE_XWAYLAND
-	if (!wl_list_empty(&root->xwayland_unmanaged)) {
-		return false;
+	output_unmanaged_for_each_surface(output, &root->xwayland_unmanaged,
+		scanout_visibility_iterator, &data);
+	if (data.n_visible > 0) {
+		return SCANOUT_UNMANAGED;
 	}
 #endif
 
-	if (!wl_list_empty(&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY])) {
-		return false;
+	output_layer_for_each_surface(output,
+		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY],
+		scanout_visibility_iterator, &data);
+	if (data.n_visible > 0) {
+		return SCANOUT_OVERLAY_LAYER;
 	}
-	if (!wl_list_empty(&root->drag_icons)) {
-		return false;
+
+	output_drag_icons_for_each_surface(output, &root->drag_icons,
+		scanout_visibility_iterator, &data);
+	if (data.n_visible > 0) {
+		return SCANOUT_DRAG_ICON;
 	}
 
 	struct wlr_surface *surface = view->surface;
-	if (surface == NULL) {
-		return false;
+	if (surface == NULL || surface->buffer == NULL) {
+		return SCANOUT_NO_BUFFER;
 	}
-	size_t n_surfaces = 0;
+
+	data.main_surface = surface;
 	output_view_for_each_surface(output, view,
-		count_surface_iterator, &n_surfaces);
-	if (n_surfaces != 1) {
-		return false;
+		scanout_visibility_iterator, &data);
+	if (data.n_visible > 0) {
+		return SCANOUT_SURFACES;
 	}
 
-	if (surface->buffer == NULL) {
-		return false;
+	if (data.main_box.x != 0 || data.main_box.y != 0 ||
+			data.main_box.width != output->width ||
+			data.main_box.height != output->height) {
+		return SCANOUT_GEOMETRY;
 	}
 
 	if ((float)surface->current.scale != wlr_output->scale ||
 			surface->current.transform != wlr_output->transform) {
-		return false;
+		return SCANOUT_TRANSFORM;
 	}
 
 	wlr_presentation_surface_sampled_on_output(server.presentation, surface,
 		wlr_output);
 
 	wlr_output_attach_buffer(wlr_output, &surface->buffer->base);
-	return wlr_output_commit(wlr_output);
+	if (!wlr_output_commit(wlr_output)) {
+		return SCANOUT_COMMIT_FAILED;
+	}
+	return SCANOUT_OK;
+}
+
+static void update_adaptive_render_time(struct sway_output *output,
+		const struct timespec *start, bool missed) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint32_t usec = (now.tv_sec - start->tv_sec) * 1000000 +
+		(now.tv_nsec - start->tv_nsec) / 1000;
+
+	int max_render_time = adaptive_render_time_update(
+		&output->adaptive_render_time, usec, missed, output->refresh_nsec);
+	if (max_render_time != output->max_render_time) {
+		sway_log(SWAY_DEBUG, "Output %s: adapting max render time to %d",
+			output->wlr_output->name, max_render_time);
+		output->max_render_time = max_render_time;
+	}
 }
 
 static int output_repaint_timer_handler(void *data) {
@@ -573,25 +748,42 @@ static int output_repaint_timer_handler(void *data) {
 		fullscreen_con = workspace->current.fullscreen;
 	}
 
+	enum sway_scanout_status scanout_status = SCANOUT_NOT_FULLSCREEN;
 	if (fullscreen_con && fullscreen_con->view) {
 		// Try to scan-out the fullscreen view
-		static bool last_scanned_out = false;
-		bool scanned_out =
+		scanout_status =
 			scan_out_fullscreen_view(output, fullscreen_con->view);
-
-		if (scanned_out && !last_scanned_out) {
-			sway_log(SWAY_DEBUG, "Scanning out fullscreen view");
+		if (scanout_status != SCANOUT_OK) {
+			output->scanout_stats.rejected[scanout_status]++;
 		}
-		if (last_scanned_out && !scanned_out) {
-			sway_log(SWAY_DEBUG, "Stopping fullscreen view scan out");
-		}
-		last_scanned_out = scanned_out;
+	}
 
-		if (scanned_out) {
-			return 0;
+	if (scanout_status != output->scanout_status) {
+		const char *name = output->wlr_output->name;
+		if (scanout_status == SCANOUT_OK) {
+			sway_log(SWAY_DEBUG, "Output %s: scanning out fullscreen view",
+				name);
+		} else if (output->scanout_status == SCANOUT_OK) {
+			sway_log(SWAY_DEBUG, "Output %s: stopping fullscreen view "
+				"scan out", name);
+		}
+		if (scanout_status != SCANOUT_OK &&
+				scanout_status != SCANOUT_NOT_FULLSCREEN) {
+			sway_log(SWAY_DEBUG, "Output %s: fullscreen scan out rejected: %s",
+				name, scanout_status_to_str(scanout_status));
 		}
+		output->scanout_status = scanout_status;
+	}
+	if (scanout_status == SCANOUT_OK) {
+		output->scanout_stats.scanned_out++;
+		return 0;
 	}
 
+	struct timespec repaint_start;
+	clock_gettime(CLOCK_MONOTONIC, &repaint_start);
+
+	output_render_prepare(output);
+
 	bool needs_frame;
 	pixman_region32_t damage;
 	pixman_region32_init(&damage);
@@ -604,7 +796,14 @@ static int output_repaint_timer_handler(void *data) {
 		struct timespec now;
 		clock_gettime(CLOCK_MONOTONIC, &now);
 
+		uint64_t missed_vblanks = output->render_stats.missed_vblanks;
 		output_render(output, &now, &damage);
+		output->scanout_stats.composited++;
+
+		if (output->max_render_time_adaptive) {
+			update_adaptive_render_time(output, &repaint_start,
+				output->render_stats.missed_vblanks != missed_vblanks);
+		}
 	} else {
 		wlr_output_rollback(output->wlr_output);
 	}
@@ -621,6 +820,9 @@ static void damage_handle_frame(struct wl_listener *listener, void *user_data) {
 		return;
 	}
 
+	// Apply queued title changes before this frame is rendered
+	view_update_pending_titles();
+
 	// Compute predicted milliseconds until the next refresh. It's used for
 	// delaying both output rendering and surface frame callbacks.
 	int msec_until_refresh = 0;
@@ -676,6 +878,22 @@ static void damage_handle_frame(struct wl_listener *listener, void *user_data) {
 	struct send_frame_done_data data = {0};
 	clock_gettime(CLOCK_MONOTONIC, &data.when);
 	data.msec_until_refresh = msec_until_refresh;
+
+	// Clients need to commit before the output is composited for their new
+	// frame to make it into the next refresh
+	int64_t nsec_until_deadline = output->max_render_time != 0 ?
+		(int64_t)delay * 1000000 : output->refresh_nsec;
+	if (nsec_until_deadline < 0) {
+		nsec_until_deadline = 0;
+	}
+	data.deadline = data.when;
+	data.deadline.tv_sec += nsec_until_deadline / 1000000000;
+	data.deadline.tv_nsec += nsec_until_deadline % 1000000000;
+	if (data.deadline.tv_nsec >= 1000000000) {
+		data.deadline.tv_sec += 1;
+		data.deadline.tv_nsec -= 1000000000;
+	}
+
 	send_frame_done(output, &data);
 }
 
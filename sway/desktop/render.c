@@ -1,6 +1,7 @@
 #define _POSIX_C_SOURCE 200809L
 #include <assert.h>
 #include <GLES2/gl2.h>
+#include <math.h>
 #include <stdlib.h>
 #include <strings.h>
 #include <time.h>
@@ -18,6 +19,9 @@
 #include "log.h"
 #include "config.h"
 #include "sway/config.h"
+#include "sway/desktop/opaque_region.h"
+#include "sway/desktop/render_stats.h"
+#include "sway/desktop/title_texture.h"
 #include "sway/input/input-manager.h"
 #include "sway/input/seat.h"
 #include "sway/layers.h"
@@ -72,6 +76,149 @@ static void scissor_output(struct wlr_output *wlr_output,
 	wlr_renderer_scissor(renderer, &box);
 }
 
+#define RECT_BATCH_MAX_COLORS 16
+
+struct rect_batch {
+	float color[4];
+	pixman_region32_t region; // output-buffer-local
+};
+
+/**
+ * Solid rectangles queued for the frame being rendered, grouped by color.
+ *
+ * Rectangles are only drawn when something is about to be rendered over
+ * them, or when the frame ends. Each batch is intersected with the damage
+ * once and every rectangle of the resulting region is drawn exactly once.
+ */
+static struct {
+	struct sway_output *output;
+	pixman_region32_t *damage;
+	struct rect_batch batches[RECT_BATCH_MAX_COLORS];
+	int nbatches;
+	pixman_region32_t pending; // Union of all batches
+	bool initialized;
+} rects;
+
+static void flush_rects(void) {
+	if (rects.nbatches == 0) {
+		return;
+	}
+	struct wlr_output *wlr_output = rects.output->wlr_output;
+	struct wlr_renderer *renderer =
+		wlr_backend_get_renderer(wlr_output->backend);
+
+	// The batched regions are already clipped, so no scissor is needed
+	wlr_renderer_scissor(renderer, NULL);
+	for (int i = 0; i < rects.nbatches; ++i) {
+		struct rect_batch *batch = &rects.batches[i];
+		pixman_region32_intersect(&batch->region, &batch->region,
+			rects.damage);
+
+		int nrects;
+		pixman_box32_t *boxes =
+			pixman_region32_rectangles(&batch->region, &nrects);
+		for (int j = 0; j < nrects; ++j) {
+			struct wlr_box box = {
+				.x = boxes[j].x1,
+				.y = boxes[j].y1,
+				.width = boxes[j].x2 - boxes[j].x1,
+				.height = boxes[j].y2 - boxes[j].y1,
+			};
+			wlr_render_rect(renderer, &box, batch->color,
+				wlr_output->transform_matrix);
+		}
+		pixman_region32_fini(&batch->region);
+	}
+	rects.nbatches = 0;
+	pixman_region32_clear(&rects.pending);
+}
+
+/**
+ * Draw the queued rectangles if any of them are below the given
+ * output-buffer-local box, which is about to be rendered.
+ */
+static void flush_rects_below(const struct wlr_box *box) {
+	if (rects.nbatches == 0) {
+		return;
+	}
+	pixman_box32_t extents = {
+		.x1 = box->x,
+		.y1 = box->y,
+		.x2 = box->x + box->width,
+		.y2 = box->y + box->height,
+	};
+	if (pixman_region32_contains_rectangle(&rects.pending, &extents) !=
+			PIXMAN_REGION_OUT) {
+		flush_rects();
+	}
+}
+
+/**
+ * Queue an output-buffer-local rectangle for drawing.
+ */
+static void queue_rect(struct sway_output *output,
+		pixman_region32_t *output_damage, const struct wlr_box *box,
+		const float color[static 4]) {
+	if (box->width <= 0 || box->height <= 0) {
+		return;
+	}
+	if (!rects.initialized) {
+		pixman_region32_init(&rects.pending);
+		rects.initialized = true;
+	}
+	if (rects.output != output || rects.damage != output_damage) {
+		flush_rects();
+		rects.output = output;
+		rects.damage = output_damage;
+	}
+
+	pixman_box32_t extents = {
+		.x1 = box->x,
+		.y1 = box->y,
+		.x2 = box->x + box->width,
+		.y2 = box->y + box->height,
+	};
+	if (pixman_region32_contains_rectangle(output_damage, &extents) ==
+			PIXMAN_REGION_OUT) {
+		return;
+	}
+
+	struct rect_batch *batch = NULL;
+	for (int i = 0; i < rects.nbatches; ++i) {
+		if (memcmp(rects.batches[i].color, color, sizeof(float) * 4) == 0) {
+			batch = &rects.batches[i];
+			break;
+		}
+	}
+
+	// Rectangles of other colors below this one must be drawn first
+	if (pixman_region32_contains_rectangle(&rects.pending, &extents) !=
+			PIXMAN_REGION_OUT) {
+		for (int i = 0; i < rects.nbatches; ++i) {
+			struct rect_batch *other = &rects.batches[i];
+			if (other != batch && pixman_region32_contains_rectangle(
+						&other->region, &extents) != PIXMAN_REGION_OUT) {
+				flush_rects();
+				batch = NULL;
+				break;
+			}
+		}
+	}
+
+	if (!batch) {
+		if (rects.nbatches == RECT_BATCH_MAX_COLORS) {
+			flush_rects();
+		}
+		batch = &rects.batches[rects.nbatches++];
+		memcpy(batch->color, color, sizeof(float) * 4);
+		pixman_region32_init(&batch->region);
+	}
+	pixman_region32_union_rect(&batch->region, &batch->region,
+		box->x, box->y, box->width, box->height);
+	pixman_region32_union_rect(&rects.pending, &rects.pending,
+		box->x, box->y, box->width, box->height);
+}
+
 static void set_scale_filter(struct wlr_output *wlr_output,
 		struct wlr_texture *texture, enum scale_filter_mode scale_filter) {
 	if (!wlr_texture_is_gles2(texture)) {
@@ -107,6 +254,8 @@ static void render_texture(struct wlr_output *wlr_output,
 	struct wlr_gles2_texture_attribs attribs;
 	wlr_gles2_texture_get_attribs(texture, &attribs);
 
+	flush_rects_below(dst_box);
+
 	pixman_region32_t damage;
 	pixman_region32_init(&damage);
 	pixman_region32_union_rect(&damage, &damage, dst_box->x, dst_box->y,
@@ -207,40 +356,53 @@ static void render_drag_icons(struct sway_output *output,
 		render_surface_iterator, &data);
 }
 
+/**
+ * Render a batch of non-overlapping rectangles of the same color. The boxes
+ * use the same coordinates as render_rect. The rectangles are queued and
+ * drawn together with all other rectangles of the same color in the frame.
+ */
+static void render_rects(struct sway_output *output,
+		pixman_region32_t *output_damage, const struct wlr_box *boxes,
+		int nboxes, float color[static 4]) {
+	double ox = output->lx * output->wlr_output->scale;
+	double oy = output->ly * output->wlr_output->scale;
+	for (int i = 0; i < nboxes; ++i) {
+		struct wlr_box box = boxes[i];
+		box.x -= ox;
+		box.y -= oy;
+		queue_rect(output, output_damage, &box, color);
+	}
+}
+
 // _box.x and .y are expected to be layout-local
 // _box.width and .height are expected to be output-buffer-local
 void render_rect(struct sway_output *output,
 		pixman_region32_t *output_damage, const struct wlr_box *_box,
 		float color[static 4]) {
-	struct wlr_output *wlr_output = output->wlr_output;
-	struct wlr_renderer *renderer =
-		wlr_backend_get_renderer(wlr_output->backend);
-
-	struct wlr_box box;
-	memcpy(&box, _box, sizeof(struct wlr_box));
-	box.x -= output->lx * wlr_output->scale;
-	box.y -= output->ly * wlr_output->scale;
-
-	pixman_region32_t damage;
-	pixman_region32_init(&damage);
-	pixman_region32_union_rect(&damage, &damage, box.x, box.y,
-		box.width, box.height);
-	pixman_region32_intersect(&damage, &damage, output_damage);
-	bool damaged = pixman_region32_not_empty(&damage);
-	if (!damaged) {
-		goto damage_finish;
-	}
+	render_rects(output, output_damage, _box, 1, color);
+}
 
-	int nrects;
-	pixman_box32_t *rects = pixman_region32_rectangles(&damage, &nrects);
-	for (int i = 0; i < nrects; ++i) {
-		scissor_output(wlr_output, &rects[i]);
-		wlr_render_rect(renderer, &box, color,
-			wlr_output->transform_matrix);
+/**
+ * Check whether a layout box intersects the damage, so decorations outside
+ * of it can be skipped without working out their individual parts.
+ */
+static bool box_is_damaged(struct sway_output *output,
+		pixman_region32_t *output_damage, const struct wlr_box *layout_box) {
+	if (layout_box->width <= 0 || layout_box->height <= 0) {
+		return false;
 	}
-
-damage_finish:
-	pixman_region32_fini(&damage);
+	struct wlr_box box = *layout_box;
+	scale_box(&box, output->wlr_output->scale);
+	box.x -= output->lx * output->wlr_output->scale;
+	box.y -= output->ly * output->wlr_output->scale;
+	pixman_box32_t rect = {
+		.x1 = box.x,
+		.y1 = box.y,
+		.x2 = box.x + box.width,
+		.y2 = box.y + box.height,
+	};
+	return pixman_region32_contains_rectangle(output_damage, &rect) !=
+		PIXMAN_REGION_OUT;
 }
 
 void premultiply_alpha(float color[4], float opacity) {
@@ -292,6 +454,20 @@ static void render_saved_view(struct sway_view *view,
 	if (wl_list_empty(&view->saved_buffers)) {
 		return;
 	}
+
+	// Slow clients which haven't caught up with the new size yet have their
+	// old contents stretched over the container
+	struct sway_container *con = view->container;
+	double sx = 1, sy = 1;
+	int ox = con->surface_x, oy = con->surface_y;
+	if (view->late_configure.pending && view->saved_geometry.width > 0 &&
+			view->saved_geometry.height > 0) {
+		sx = (double)con->current.content_width / view->saved_geometry.width;
+		sy = (double)con->current.content_height / view->saved_geometry.height;
+		ox = con->current.content_x;
+		oy = con->current.content_y;
+	}
+
 	struct sway_saved_buffer *saved_buf;
 	wl_list_for_each(saved_buf, &view->saved_buffers, link) {
 		if (!saved_buf->buffer->texture) {
@@ -299,12 +475,12 @@ static void render_saved_view(struct sway_view *view,
 		}
 
 		struct wlr_box box = {
-			.x = view->container->surface_x - output->lx -
-				view->saved_geometry.x + saved_buf->x,
-			.y = view->container->surface_y - output->ly -
-				view->saved_geometry.y + saved_buf->y,
-			.width = saved_buf->width,
-			.height = saved_buf->height,
+			.x = ox - output->lx +
+				round((saved_buf->x - view->saved_geometry.x) * sx),
+			.y = oy - output->ly +
+				round((saved_buf->y - view->saved_geometry.y) * sy),
+			.width = round(saved_buf->width * sx),
+			.height = round(saved_buf->height * sy),
 		};
 
 		struct wlr_box output_box = {
@@ -350,55 +526,36 @@ static void render_view(struct sway_output *output, pixman_region32_t *damage,
 		return;
 	}
 
-	struct wlr_box box;
-	float output_scale = output->wlr_output->scale;
-	float color[4];
-	struct sway_container_state *state = &con->current;
-
-	if (state->border_left) {
-		memcpy(&color, colors->child_border, sizeof(float) * 4);
-		premultiply_alpha(color, con->alpha);
-		box.x = state->x;
-		box.y = state->content_y;
-		box.width = state->border_thickness;
-		box.height = state->content_height;
-		scale_box(&box, output_scale);
-		render_rect(output, damage, &box, color);
+	struct sway_container_decorations *deco = &con->current.decorations;
+	if (!box_is_damaged(output, damage, &deco->border_bounds)) {
+		return;
 	}
 
-	list_t *siblings = container_get_current_siblings(con);
-	enum sway_container_layout layout =
-		container_current_parent_layout(con);
-
-	if (state->border_right) {
-		if (con->current.parent && siblings->length == 1 && layout == L_HORIZ) {
-			memcpy(&color, colors->indicator, sizeof(float) * 4);
-		} else {
-			memcpy(&color, colors->child_border, sizeof(float) * 4);
+	float output_scale = output->wlr_output->scale;
+	float color[4], indicator_color[4];
+	memcpy(&color, colors->child_border, sizeof(float) * 4);
+	premultiply_alpha(color, con->alpha);
+	memcpy(&indicator_color, colors->indicator, sizeof(float) * 4);
+	premultiply_alpha(indicator_color, con->alpha);
+
+	struct wlr_box boxes[4], indicator_boxes[2];
+	int nboxes = 0, nindicator_boxes = 0;
+	for (int i = 0; i < 4; ++i) {
+		struct wlr_box box = deco->borders[i];
+		if (box.width <= 0 || box.height <= 0) {
+			continue;
 		}
-		premultiply_alpha(color, con->alpha);
-		box.x = state->content_x + state->content_width;
-		box.y = state->content_y;
-		box.width = state->border_thickness;
-		box.height = state->content_height;
 		scale_box(&box, output_scale);
-		render_rect(output, damage, &box, color);
-	}
-
-	if (state->border_bottom) {
-		if (con->current.parent && siblings->length == 1 && layout == L_VERT) {
-			memcpy(&color, colors->indicator, sizeof(float) * 4);
+		if ((i == EDGE_RIGHT && deco->right_indicator) ||
+				(i == EDGE_BOTTOM && deco->bottom_indicator)) {
+			indicator_boxes[nindicator_boxes++] = box;
 		} else {
-			memcpy(&color, colors->child_border, sizeof(float) * 4);
+			boxes[nboxes++] = box;
 		}
-		premultiply_alpha(color, con->alpha);
-		box.x = state->x;
-		box.y = state->content_y + state->content_height;
-		box.width = state->width;
-		box.height = state->border_thickness;
-		scale_box(&box, output_scale);
-		render_rect(output, damage, &box, color);
 	}
+	render_rects(output, damage, boxes, nboxes, color);
+	render_rects(output, damage, indicator_boxes, nindicator_boxes,
+		indicator_color);
 }
 
 /**
@@ -409,66 +566,59 @@ static void render_view(struct sway_output *output, pixman_region32_t *damage,
  *
  * The height is: 1px border, 3px padding, font height, 3px padding, 1px border
  * The left side is: 1px border, 2px padding, title
+ *
+ * The geometry which doesn't depend on the textures is precomputed in the
+ * container's decorations when the transaction is applied.
  */
 static void render_titlebar(struct sway_output *output,
 		pixman_region32_t *output_damage, struct sway_container *con,
-		int x, int y, int width,
-		struct border_colors *colors, struct wlr_texture *title_texture,
-		struct wlr_texture *marks_texture) {
+		struct border_colors *colors) {
+	struct sway_container_decorations *deco = &con->current.decorations;
+	if (!deco->has_titlebar ||
+			!box_is_damaged(output, output_damage, &deco->titlebar)) {
+		return;
+	}
+
 	struct wlr_box box;
-	float color[4];
+	float border_color[4], background_color[4];
 	float output_scale = output->wlr_output->scale;
 	double output_x = output->lx;
 	double output_y = output->ly;
-	int titlebar_border_thickness = config->titlebar_border_thickness;
 	int titlebar_h_padding = config->titlebar_h_padding;
-	int titlebar_v_padding = config->titlebar_v_padding;
 	enum alignment title_align = config->title_align;
+	struct sway_title_texture *title =
+		container_get_title_texture(con, colors);
+	struct sway_title_texture *marks =
+		container_get_marks_texture(con, colors);
+	struct wlr_texture *title_texture = title ? title->texture : NULL;
+	struct wlr_texture *marks_texture = marks ? marks->texture : NULL;
+
+	memcpy(&border_color, colors->border, sizeof(float) * 4);
+	premultiply_alpha(border_color, con->alpha);
+	memcpy(&background_color, colors->background, sizeof(float) * 4);
+	premultiply_alpha(background_color, con->alpha);
+
+	// Single pixel bars around the title
+	struct wlr_box border_boxes[4];
+	for (int i = 0; i < 4; ++i) {
+		border_boxes[i] = deco->titlebar_edges[i];
+		scale_box(&border_boxes[i], output_scale);
+	}
+	render_rects(output, output_damage, border_boxes, 4, border_color);
 
-	// Single pixel bar above title
-	memcpy(&color, colors->border, sizeof(float) * 4);
-	premultiply_alpha(color, con->alpha);
-	box.x = x;
-	box.y = y;
-	box.width = width;
-	box.height = titlebar_border_thickness;
-	scale_box(&box, output_scale);
-	render_rect(output, output_damage, &box, color);
-
-	// Single pixel bar below title
-	box.x = x;
-	box.y = y + container_titlebar_height() - titlebar_border_thickness;
-	box.width = width;
-	box.height = titlebar_border_thickness;
-	scale_box(&box, output_scale);
-	render_rect(output, output_damage, &box, color);
-
-	// Single pixel left edge
-	box.x = x;
-	box.y = y + titlebar_border_thickness;
-	box.width = titlebar_border_thickness;
-	box.height = container_titlebar_height() - titlebar_border_thickness * 2;
-	scale_box(&box, output_scale);
-	render_rect(output, output_damage, &box, color);
-
-	// Single pixel right edge
-	box.x = x + width - titlebar_border_thickness;
-	box.y = y + titlebar_border_thickness;
-	box.width = titlebar_border_thickness;
-	box.height = container_titlebar_height() - titlebar_border_thickness * 2;
-	scale_box(&box, output_scale);
-	render_rect(output, output_damage, &box, color);
+	// Everything inside the border is collected here and drawn in one batch
+	struct wlr_box background_boxes[7];
+	int nbackground_boxes = 0;
 
-	int inner_x = x - output_x + titlebar_h_padding;
-	int bg_y = y + titlebar_border_thickness;
-	size_t inner_width = width - titlebar_h_padding * 2;
+	int inner_x = deco->titlebar.x - output_x + titlebar_h_padding;
+	int bg_y = deco->titlebar_background.y;
+	size_t inner_width = deco->titlebar.width - titlebar_h_padding * 2;
 
 	// output-buffer local
 	int ob_inner_x = round(inner_x * output_scale);
 	int ob_inner_width = scale_length(inner_width, inner_x, output_scale);
-	int ob_bg_height = scale_length(
-			(titlebar_v_padding - titlebar_border_thickness) * 2 +
-			config->font_height, bg_y, output_scale);
+	int ob_bg_height = scale_length(deco->titlebar_background.height,
+			bg_y, output_scale);
 
 	// Marks
 	int ob_marks_x = 0; // output-buffer-local
@@ -509,18 +659,16 @@ static void render_titlebar(struct sway_output *output,
 			NULL, &texture_box, matrix, con->alpha);
 
 		// Padding above
-		memcpy(&color, colors->background, sizeof(float) * 4);
-		premultiply_alpha(color, con->alpha);
 		box.x = texture_box.x + round(output_x * output_scale);
-		box.y = round((y + titlebar_border_thickness) * output_scale);
+		box.y = round(bg_y * output_scale);
 		box.width = texture_box.width;
 		box.height = ob_padding_above;
-		render_rect(output, output_damage, &box, color);
+		background_boxes[nbackground_boxes++] = box;
 
 		// Padding below
 		box.y += ob_padding_above + texture_box.height;
 		box.height = ob_padding_below;
-		render_rect(output, output_damage, &box, color);
+		background_boxes[nbackground_boxes++] = box;
 	}
 
 	// Title text
@@ -535,8 +683,8 @@ static void render_titlebar(struct sway_output *output,
 		// The title texture might be shorter than the config->font_height,
 		// in which case we need to pad it above and below.
 		int ob_padding_above = round((config->font_baseline -
-					con->title_baseline + titlebar_v_padding -
-					titlebar_border_thickness) * output_scale);
+					con->title_baseline + config->titlebar_v_padding -
+					config->titlebar_border_thickness) * output_scale);
 		int ob_padding_below = ob_bg_height - ob_padding_above -
 			texture_box.height;
 
@@ -577,18 +725,16 @@ static void render_titlebar(struct sway_output *output,
 			NULL, &texture_box, matrix, con->alpha);
 
 		// Padding above
-		memcpy(&color, colors->background, sizeof(float) * 4);
-		premultiply_alpha(color, con->alpha);
 		box.x = texture_box.x + round(output_x * output_scale);
-		box.y = round((y + titlebar_border_thickness) * output_scale);
+		box.y = round(bg_y * output_scale);
 		box.width = texture_box.width;
 		box.height = ob_padding_above;
-		render_rect(output, output_damage, &box, color);
+		background_boxes[nbackground_boxes++] = box;
 
 		// Padding below
 		box.y += ob_padding_above + texture_box.height;
 		box.height = ob_padding_below;
-		render_rect(output, output_damage, &box, color);
+		background_boxes[nbackground_boxes++] = box;
 	}
 
 	// Determine the left + right extends of the textures (output-buffer local)
@@ -622,70 +768,67 @@ static void render_titlebar(struct sway_output *output,
 		box.x = ob_left_x + ob_left_width + round(output_x * output_scale);
 		box.y = round(bg_y * output_scale);
 		box.height = ob_bg_height;
-		render_rect(output, output_damage, &box, color);
+		background_boxes[nbackground_boxes++] = box;
 	}
 
 	// Padding on left side
-	box.x = x + titlebar_border_thickness;
-	box.y = y + titlebar_border_thickness;
-	box.width = titlebar_h_padding - titlebar_border_thickness;
-	box.height = (titlebar_v_padding - titlebar_border_thickness) * 2 +
-		config->font_height;
+	box = deco->titlebar_padding[0];
 	scale_box(&box, output_scale);
 	int left_x = ob_left_x + round(output_x * output_scale);
 	if (box.x + box.width < left_x) {
 		box.width += left_x - box.x - box.width;
 	}
-	render_rect(output, output_damage, &box, color);
+	background_boxes[nbackground_boxes++] = box;
 
 	// Padding on right side
-	box.x = x + width - titlebar_h_padding;
-	box.y = y + titlebar_border_thickness;
-	box.width = titlebar_h_padding - titlebar_border_thickness;
-	box.height = (titlebar_v_padding - titlebar_border_thickness) * 2 +
-		config->font_height;
+	box = deco->titlebar_padding[1];
 	scale_box(&box, output_scale);
 	int right_rx = ob_right_x + ob_right_width + round(output_x * output_scale);
 	if (right_rx < box.x) {
 		box.width += box.x - right_rx;
 		box.x = right_rx;
 	}
-	render_rect(output, output_damage, &box, color);
-}
-
-/**
- * Render the top border line for a view using "border pixel".
- */
-static void render_top_border(struct sway_output *output,
-		pixman_region32_t *output_damage, struct sway_container *con,
-		struct border_colors *colors) {
-	struct sway_container_state *state = &con->current;
-	if (!state->border_top) {
-		return;
-	}
-	struct wlr_box box;
-	float color[4];
-	float output_scale = output->wlr_output->scale;
+	background_boxes[nbackground_boxes++] = box;
 
-	// Child border - top edge
-	memcpy(&color, colors->child_border, sizeof(float) * 4);
-	premultiply_alpha(color, con->alpha);
-	box.x = state->x;
-	box.y = state->y;
-	box.width = state->width;
-	box.height = state->border_thickness;
-	scale_box(&box, output_scale);
-	render_rect(output, output_damage, &box, color);
+	// Without any text, the padding keeps the border color
+	render_rects(output, output_damage, background_boxes, nbackground_boxes,
+		title_texture || marks_texture ? background_color : border_color);
 }
 
 struct parent_data {
 	enum sway_container_layout layout;
-	struct wlr_box box;
 	list_t *children;
 	bool focused;
 	struct sway_container *active_child;
 };
 
+/**
+ * Select the border colors of a child with a titlebar, given its parent.
+ */
+static struct border_colors *get_child_colors(struct sway_container *child,
+		struct parent_data *parent) {
+	bool urgent = child->view ?
+		view_is_urgent(child->view) : container_has_urgent_child(child);
+
+	if (urgent) {
+		return &config->border_colors.urgent;
+	} else if (child->current.focused || parent->focused) {
+		return &config->border_colors.focused;
+	} else if (child == parent->active_child) {
+		return &config->border_colors.focused_inactive;
+	}
+	return &config->border_colors.unfocused;
+}
+
+static struct border_colors *get_floating_colors(struct sway_container *con) {
+	if (view_is_urgent(con->view)) {
+		return &config->border_colors.urgent;
+	} else if (con->current.focused) {
+		return &config->border_colors.focused;
+	}
+	return &config->border_colors.unfocused;
+}
+
 static void render_container(struct sway_output *output,
 	pixman_region32_t *damage, struct sway_container *con, bool parent_focused);
 
@@ -701,37 +844,8 @@ static void render_containers_linear(struct sway_output *output,
 		struct sway_container *child = parent->children->items[i];
 
 		if (child->view) {
-			struct sway_view *view = child->view;
-			struct border_colors *colors;
-			struct wlr_texture *title_texture;
-			struct wlr_texture *marks_texture;
-			struct sway_container_state *state = &child->current;
-
-			if (view_is_urgent(view)) {
-				colors = &config->border_colors.urgent;
-				title_texture = child->title_urgent;
-				marks_texture = child->marks_urgent;
-			} else if (state->focused || parent->focused) {
-				colors = &config->border_colors.focused;
-				title_texture = child->title_focused;
-				marks_texture = child->marks_focused;
-			} else if (child == parent->active_child) {
-				colors = &config->border_colors.focused_inactive;
-				title_texture = child->title_focused_inactive;
-				marks_texture = child->marks_focused_inactive;
-			} else {
-				colors = &config->border_colors.unfocused;
-				title_texture = child->title_unfocused;
-				marks_texture = child->marks_unfocused;
-			}
-
-			if (state->border == B_NORMAL) {
-				render_titlebar(output, damage, child, state->x,
-						state->y, state->width, colors,
-						title_texture, marks_texture);
-			} else if (state->border == B_PIXEL) {
-				render_top_border(output, damage, child, colors);
-			}
+			struct border_colors *colors = get_child_colors(child, parent);
+			render_titlebar(output, damage, child, colors);
 			render_view(output, damage, child, colors);
 		} else {
 			render_container(output, damage, child,
@@ -750,46 +864,12 @@ static void render_containers_tabbed(struct sway_output *output,
 	}
 	struct sway_container *current = parent->active_child;
 	struct border_colors *current_colors = &config->border_colors.unfocused;
-	int tab_width = parent->box.width / parent->children->length;
 
 	// Render tabs
 	for (int i = 0; i < parent->children->length; ++i) {
 		struct sway_container *child = parent->children->items[i];
-		struct sway_view *view = child->view;
-		struct sway_container_state *cstate = &child->current;
-		struct border_colors *colors;
-		struct wlr_texture *title_texture;
-		struct wlr_texture *marks_texture;
-		bool urgent = view ?
-			view_is_urgent(view) : container_has_urgent_child(child);
-
-		if (urgent) {
-			colors = &config->border_colors.urgent;
-			title_texture = child->title_urgent;
-			marks_texture = child->marks_urgent;
-		} else if (cstate->focused || parent->focused) {
-			colors = &config->border_colors.focused;
-			title_texture = child->title_focused;
-			marks_texture = child->marks_focused;
-		} else if (child == parent->active_child) {
-			colors = &config->border_colors.focused_inactive;
-			title_texture = child->title_focused_inactive;
-			marks_texture = child->marks_focused_inactive;
-		} else {
-			colors = &config->border_colors.unfocused;
-			title_texture = child->title_unfocused;
-			marks_texture = child->marks_unfocused;
-		}
-
-		int x = cstate->x + tab_width * i;
-
-		// Make last tab use the remaining width of the parent
-		if (i == parent->children->length - 1) {
-			tab_width = parent->box.width - tab_width * i;
-		}
-
-		render_titlebar(output, damage, child, x, parent->box.y, tab_width,
-				colors, title_texture, marks_texture);
+		struct border_colors *colors = get_child_colors(child, parent);
+		render_titlebar(output, damage, child, colors);
 
 		if (child == current) {
 			current_colors = colors;
@@ -815,40 +895,12 @@ static void render_containers_stacked(struct sway_output *output,
 	}
 	struct sway_container *current = parent->active_child;
 	struct border_colors *current_colors = &config->border_colors.unfocused;
-	size_t titlebar_height = container_titlebar_height();
 
 	// Render titles
 	for (int i = 0; i < parent->children->length; ++i) {
 		struct sway_container *child = parent->children->items[i];
-		struct sway_view *view = child->view;
-		struct sway_container_state *cstate = &child->current;
-		struct border_colors *colors;
-		struct wlr_texture *title_texture;
-		struct wlr_texture *marks_texture;
-		bool urgent = view ?
-			view_is_urgent(view) : container_has_urgent_child(child);
-
-		if (urgent) {
-			colors = &config->border_colors.urgent;
-			title_texture = child->title_urgent;
-			marks_texture = child->marks_urgent;
-		} else if (cstate->focused || parent->focused) {
-			colors = &config->border_colors.focused;
-			title_texture = child->title_focused;
-			marks_texture = child->marks_focused;
-		} else if (child == parent->active_child) {
-			colors = &config->border_colors.focused_inactive;
-			title_texture = child->title_focused_inactive;
-			marks_texture = child->marks_focused_inactive;
-		} else {
-			colors = &config->border_colors.unfocused;
-			title_texture = child->title_unfocused;
-			marks_texture = child->marks_unfocused;
-		}
-
-		int y = parent->box.y + titlebar_height * i;
-		render_titlebar(output, damage, child, parent->box.x, y,
-				parent->box.width, colors, title_texture, marks_texture);
+		struct border_colors *colors = get_child_colors(child, parent);
+		render_titlebar(output, damage, child, colors);
 
 		if (child == current) {
 			current_colors = colors;
@@ -893,12 +945,6 @@ static void render_container(struct sway_output *output,
 		pixman_region32_t *damage, struct sway_container *con, bool focused) {
 	struct parent_data data = {
 		.layout = con->current.layout,
-		.box = {
-			.x = con->current.x,
-			.y = con->current.y,
-			.width = con->current.width,
-			.height = con->current.height,
-		},
 		.children = con->current.children,
 		.focused = focused,
 		.active_child = con->current.focused_inactive_child,
@@ -910,12 +956,6 @@ static void render_workspace(struct sway_output *output,
 		pixman_region32_t *damage, struct sway_workspace *ws, bool focused) {
 	struct parent_data data = {
 		.layout = ws->current.layout,
-		.box = {
-			.x = ws->current.x,
-			.y = ws->current.y,
-			.width = ws->current.width,
-			.height = ws->current.height,
-		},
 		.children = ws->current.tiling,
 		.focused = focused,
 		.active_child = ws->current.focused_inactive_child,
@@ -926,32 +966,8 @@ static void render_workspace(struct sway_output *output,
 static void render_floating_container(struct sway_output *soutput,
 		pixman_region32_t *damage, struct sway_container *con) {
 	if (con->view) {
-		struct sway_view *view = con->view;
-		struct border_colors *colors;
-		struct wlr_texture *title_texture;
-		struct wlr_texture *marks_texture;
-
-		if (view_is_urgent(view)) {
-			colors = &config->border_colors.urgent;
-			title_texture = con->title_urgent;
-			marks_texture = con->marks_urgent;
-		} else if (con->current.focused) {
-			colors = &config->border_colors.focused;
-			title_texture = con->title_focused;
-			marks_texture = con->marks_focused;
-		} else {
-			colors = &config->border_colors.unfocused;
-			title_texture = con->title_unfocused;
-			marks_texture = con->marks_unfocused;
-		}
-
-		if (con->current.border == B_NORMAL) {
-			render_titlebar(soutput, damage, con, con->current.x,
-					con->current.y, con->current.width, colors,
-					title_texture, marks_texture);
-		} else if (con->current.border == B_PIXEL) {
-			render_top_border(soutput, damage, con, colors);
-		}
+		struct border_colors *colors = get_floating_colors(con);
+		render_titlebar(soutput, damage, con, colors);
 		render_view(soutput, damage, con, colors);
 	} else {
 		render_container(soutput, damage, con, con->current.focused);
@@ -986,6 +1002,187 @@ static void render_seatops(struct sway_output *output,
 	}
 }
 
+static void get_container_parent_data(struct sway_container *con,
+		bool focused, struct parent_data *data) {
+	*data = (struct parent_data){
+		.layout = con->current.layout,
+		.children = con->current.children,
+		.focused = focused,
+		.active_child = con->current.focused_inactive_child,
+	};
+}
+
+/**
+ * Rasterize the titlebar textures of the given children which will be
+ * displayed, mirroring the traversal done by render_containers.
+ */
+static void prepare_containers(struct parent_data *parent) {
+	bool linear = parent->layout == L_NONE || parent->layout == L_HORIZ ||
+		parent->layout == L_VERT;
+	if (config->hide_lone_tab && parent->children->length == 1) {
+		struct sway_container *child = parent->children->items[0];
+		linear = linear || child->view;
+	}
+
+	for (int i = 0; i < parent->children->length; ++i) {
+		struct sway_container *child = parent->children->items[i];
+		if (child->current.decorations.has_titlebar) {
+			container_prepare_title_textures(child,
+					get_child_colors(child, parent));
+		}
+		if (!child->view && (linear || child == parent->active_child)) {
+			struct parent_data data;
+			get_container_parent_data(child,
+					parent->focused || child->current.focused, &data);
+			prepare_containers(&data);
+		}
+	}
+}
+
+static void prepare_floating_container(struct sway_container *con) {
+	if (con->view) {
+		if (con->current.decorations.has_titlebar) {
+			container_prepare_title_textures(con, get_floating_colors(con));
+		}
+	} else {
+		struct parent_data data;
+		get_container_parent_data(con, con->current.focused, &data);
+		prepare_containers(&data);
+	}
+}
+
+static void prepare_floating(void) {
+	for (int i = 0; i < root->outputs->length; ++i) {
+		struct sway_output *output = root->outputs->items[i];
+		for (int j = 0; j < output->current.workspaces->length; ++j) {
+			struct sway_workspace *ws = output->current.workspaces->items[j];
+			if (!workspace_is_visible(ws)) {
+				continue;
+			}
+			for (int k = 0; k < ws->current.floating->length; ++k) {
+				struct sway_container *floater = ws->current.floating->items[k];
+				if (floater->fullscreen_mode == FULLSCREEN_NONE) {
+					prepare_floating_container(floater);
+				}
+			}
+		}
+	}
+}
+
+void output_render_prepare(struct sway_output *output) {
+	struct sway_workspace *workspace = output->current.active_workspace;
+	if (workspace == NULL || output_has_opaque_overlay_layer_surface(output)) {
+		return;
+	}
+
+	struct sway_container *fullscreen_con = root->fullscreen_global;
+	if (!fullscreen_con) {
+		fullscreen_con = workspace->current.fullscreen;
+	}
+
+	if (fullscreen_con) {
+		if (!fullscreen_con->view) {
+			struct parent_data data;
+			get_container_parent_data(fullscreen_con,
+					fullscreen_con->current.focused, &data);
+			prepare_containers(&data);
+		}
+		for (int i = 0; i < workspace->current.floating->length; ++i) {
+			struct sway_container *floater =
+				workspace->current.floating->items[i];
+			if (container_is_transient_for(floater, fullscreen_con)) {
+				prepare_floating_container(floater);
+			}
+		}
+		return;
+	}
+
+	struct parent_data data = {
+		.layout = workspace->current.layout,
+		.children = workspace->current.tiling,
+		.focused = workspace->current.focused,
+		.active_child = workspace->current.focused_inactive_child,
+	};
+	prepare_containers(&data);
+	prepare_floating();
+}
+
+/**
+ * The damage left to draw for each layer once the areas covered by opaque
+ * surfaces stacked above it are removed. All regions are output-buffer-local.
+ */
+struct occlusion {
+	pixman_region32_t floating;
+	pixman_region32_t tiling;
+	pixman_region32_t background;
+};
+
+/**
+ * Work out how much of the damage each layer below the top layer needs to
+ * draw. Surfaces are only culled at integer scales, where their opaque
+ * regions line up exactly with the pixels they cover.
+ */
+static void occlusion_init(struct occlusion *occlusion,
+		struct sway_output *output, struct sway_workspace *workspace,
+		pixman_region32_t *damage) {
+	pixman_region32_init(&occlusion->floating);
+	pixman_region32_init(&occlusion->tiling);
+	pixman_region32_init(&occlusion->background);
+
+	pixman_region32_t occluded;
+	pixman_region32_init(&occluded);
+	bool cull = opaque_region_usable(output);
+
+	if (cull) {
+		opaque_region_add_top_layer(output, &occluded);
+	}
+	pixman_region32_subtract(&occlusion->floating, damage, &occluded);
+
+	if (cull) {
+		opaque_region_add_floating(output, &occluded);
+	}
+	pixman_region32_subtract(&occlusion->tiling, damage, &occluded);
+
+	if (cull) {
+		opaque_region_add_tiling(output, workspace, &occluded);
+	}
+	pixman_region32_subtract(&occlusion->background, damage, &occluded);
+
+	pixman_region32_fini(&occluded);
+}
+
+static void occlusion_fini(struct occlusion *occlusion) {
+	pixman_region32_fini(&occlusion->floating);
+	pixman_region32_fini(&occlusion->tiling);
+	pixman_region32_fini(&occlusion->background);
+}
+
+/**
+ * Predict when the refresh following the start of this frame happens, in the
+ * presentation clock. Returns false if the refresh rate isn't known yet.
+ */
+static bool get_predicted_refresh(struct sway_output *output,
+		clockid_t presentation_clock, struct timespec *predicted) {
+	if (output->refresh_nsec == 0 || (output->last_presentation.tv_sec == 0 &&
+			output->last_presentation.tv_nsec == 0)) {
+		return false;
+	}
+	struct timespec now;
+	clock_gettime(presentation_clock, &now);
+
+	const int64_t NSEC_IN_SECONDS = 1000000000;
+	int64_t elapsed =
+		(now.tv_sec - output->last_presentation.tv_sec) * NSEC_IN_SECONDS +
+		(now.tv_nsec - output->last_presentation.tv_nsec);
+	int64_t periods = elapsed < 0 ? 1 : elapsed / output->refresh_nsec + 1;
+	int64_t nsec = output->last_presentation.tv_nsec +
+		periods * output->refresh_nsec;
+	predicted->tv_sec = output->last_presentation.tv_sec +
+		nsec / NSEC_IN_SECONDS;
+	predicted->tv_nsec = nsec % NSEC_IN_SECONDS;
+	return true;
+}
+
 void output_render(struct sway_output *output, struct timespec *when,
 		pixman_region32_t *damage) {
 	struct wlr_output *wlr_output = output->wlr_output;
@@ -1007,6 +1204,14 @@ void output_render(struct sway_output *output, struct timespec *when,
 		fullscreen_con = workspace->current.fullscreen;
 	}
 
+	struct render_timer timer;
+	render_timer_start(&timer);
+	clockid_t presentation_clock =
+		wlr_backend_get_presentation_clock(wlr_output->backend);
+	struct timespec predicted_refresh;
+	bool refresh_known = get_predicted_refresh(output, presentation_clock,
+		&predicted_refresh);
+
 	wlr_renderer_begin(renderer, wlr_output->width, wlr_output->height);
 
 	if (!pixman_region32_not_empty(damage)) {
@@ -1022,6 +1227,8 @@ void output_render(struct sway_output *output, struct timespec *when,
 		pixman_region32_union_rect(damage, damage, 0, 0, width, height);
 	}
 
+	render_timer_phase(&timer, RENDER_PHASE_CLEAR);
+
 	if (output_has_opaque_overlay_layer_surface(output)) {
 		goto render_overlay;
 	}
@@ -1035,6 +1242,7 @@ void output_render(struct sway_output *output, struct timespec *when,
 			scissor_output(wlr_output, &rects[i]);
 			wlr_renderer_clear(renderer, clear_color);
 		}
+		render_timer_phase(&timer, RENDER_PHASE_CLEAR);
 
 		if (fullscreen_con->view) {
 			if (!wl_list_empty(&fullscreen_con->view->saved_buffers)) {
@@ -1047,6 +1255,10 @@ void output_render(struct sway_output *output, struct timespec *when,
 			render_container(output, damage, fullscreen_con,
 					fullscreen_con->current.focused);
 		}
+		// Queued rects are drawn within the phase which queued them, so that
+		// their cost isn't booked to a later phase
+		flush_rects();
+		render_timer_phase(&timer, RENDER_PHASE_WORKSPACE);
 
 		for (int i = 0; i < workspace->current.floating->length; ++i) {
 			struct sway_container *floater =
@@ -1058,26 +1270,41 @@ void output_render(struct sway_output *output, struct timespec *when,
 #if HAVE_XWAYLAND
 		render_unmanaged(output, damage, &root->xwayland_unmanaged);
 #endif
+		flush_rects();
+		render_timer_phase(&timer, RENDER_PHASE_FLOATING);
 	} else {
 		float clear_color[] = {0.25f, 0.25f, 0.25f, 1.0f};
 
+		// Skip drawing whatever is hidden below opaque surfaces
+		struct occlusion occlusion;
+		occlusion_init(&occlusion, output, workspace, damage);
+
 		int nrects;
-		pixman_box32_t *rects = pixman_region32_rectangles(damage, &nrects);
+		pixman_box32_t *rects =
+			pixman_region32_rectangles(&occlusion.background, &nrects);
 		for (int i = 0; i < nrects; ++i) {
 			scissor_output(wlr_output, &rects[i]);
 			wlr_renderer_clear(renderer, clear_color);
 		}
+		render_timer_phase(&timer, RENDER_PHASE_CLEAR);
 
-		render_layer_toplevel(output, damage,
+		render_layer_toplevel(output, &occlusion.background,
 			&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND]);
-		render_layer_toplevel(output, damage,
+		render_layer_toplevel(output, &occlusion.background,
 			&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BOTTOM]);
-
-		render_workspace(output, damage, workspace, workspace->current.focused);
-		render_floating(output, damage);
+		render_timer_phase(&timer, RENDER_PHASE_LAYERS);
+
+		render_workspace(output, &occlusion.tiling, workspace,
+			workspace->current.focused);
+		flush_rects();
+		render_timer_phase(&timer, RENDER_PHASE_WORKSPACE);
+		render_floating(output, &occlusion.floating);
+		flush_rects();
+		occlusion_fini(&occlusion);
 #if HAVE_XWAYLAND
 		render_unmanaged(output, damage, &root->xwayland_unmanaged);
 #endif
+		render_timer_phase(&timer, RENDER_PHASE_FLOATING);
 		render_layer_toplevel(output, damage,
 			&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_TOP]);
 
@@ -1087,6 +1314,7 @@ void output_render(struct sway_output *output, struct timespec *when,
 			&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BOTTOM]);
 		render_layer_popups(output, damage,
 			&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_TOP]);
+		render_timer_phase(&timer, RENDER_PHASE_LAYERS);
 	}
 
 	render_seatops(output, damage);
@@ -1097,16 +1325,23 @@ void output_render(struct sway_output *output, struct timespec *when,
 		render_view_popups(focus->view, output, damage, focus->alpha);
 	}
 
+	flush_rects();
+	render_timer_phase(&timer, RENDER_PHASE_POPUPS);
+
 render_overlay:
 	render_layer_toplevel(output, damage,
 		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY]);
 	render_layer_popups(output, damage,
 		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY]);
+	render_timer_phase(&timer, RENDER_PHASE_LAYERS);
 	render_drag_icons(output, damage, &root->drag_icons);
 
 renderer_end:
+	flush_rects();
+	render_timer_phase(&timer, RENDER_PHASE_POPUPS);
 	wlr_renderer_scissor(renderer, NULL);
 	wlr_output_render_software_cursors(wlr_output, damage);
+	render_timer_phase(&timer, RENDER_PHASE_CURSORS);
 	wlr_renderer_end(renderer);
 
 	int width, height;
@@ -1128,7 +1363,11 @@ renderer_end:
 	wlr_output_set_damage(wlr_output, &frame_damage);
 	pixman_region32_fini(&frame_damage);
 
-	if (!wlr_output_commit(wlr_output)) {
+	bool committed = wlr_output_commit(wlr_output);
+	render_timer_phase(&timer, RENDER_PHASE_COMMIT);
+	render_stats_add_frame(&output->render_stats, &timer,
+		refresh_known ? &predicted_refresh : NULL, presentation_clock);
+	if (!committed) {
 		return;
 	}
 	output->last_frame = *when;
@@ -0,0 +1,144 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sway/desktop/render_stats.h"
+
+// Repaints needed before the max render time is adapted
+#define ADAPTIVE_RENDER_TIME_MIN_SAMPLES 16
+// Percentile of the repaint durations which must fit in the max render time
+#define ADAPTIVE_RENDER_TIME_PERCENTILE 95
+#define ADAPTIVE_RENDER_TIME_MARGIN_USEC 1000
+#define ADAPTIVE_RENDER_TIME_MAX_BACKOFF_MSEC 8
+// Frames without misses after which the backoff decays by one millisecond
+#define ADAPTIVE_RENDER_TIME_DECAY_FRAMES 120
+
+static int64_t timespec_diff_usec(const struct timespec *a,
+		const struct timespec *b) {
+	return (int64_t)(a->tv_sec - b->tv_sec) * 1000000 +
+		(a->tv_nsec - b->tv_nsec) / 1000;
+}
+
+static void histogram_add(struct render_histogram *hist, uint64_t usec) {
+	int bucket = 0;
+	while (bucket < RENDER_HISTOGRAM_BUCKETS - 1 &&
+			usec >= ((uint64_t)1 << bucket)) {
+		++bucket;
+	}
+	hist->buckets[bucket]++;
+	hist->count++;
+	hist->total_usec += usec;
+	if (usec > hist->max_usec) {
+		hist->max_usec = usec;
+	}
+}
+
+void render_stats_reset(struct render_stats *stats) {
+	memset(stats, 0, sizeof(struct render_stats));
+	clock_gettime(CLOCK_MONOTONIC, &stats->reset_time);
+}
+
+void render_timer_start(struct render_timer *timer) {
+	memset(timer, 0, sizeof(struct render_timer));
+	clock_gettime(CLOCK_MONOTONIC, &timer->start);
+	timer->last = timer->start;
+}
+
+void render_timer_phase(struct render_timer *timer, enum render_phase phase) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	timer->phase_usec[phase] += timespec_diff_usec(&now, &timer->last);
+	timer->last = now;
+}
+
+void render_stats_add_frame(struct render_stats *stats,
+		struct render_timer *timer, const struct timespec *predicted_refresh,
+		clockid_t presentation_clock) {
+	for (int i = 0; i < RENDER_PHASE_COUNT; ++i) {
+		histogram_add(&stats->phases[i], timer->phase_usec[i]);
+	}
+	histogram_add(&stats->total,
+		timespec_diff_usec(&timer->last, &timer->start));
+
+	if (predicted_refresh) {
+		struct timespec now;
+		clock_gettime(presentation_clock, &now);
+		int64_t slack = timespec_diff_usec(predicted_refresh, &now);
+		if (slack < 0) {
+			stats->missed_vblanks++;
+		} else {
+			histogram_add(&stats->slack, slack);
+		}
+	}
+}
+
+const char *render_phase_to_str(enum render_phase phase) {
+	switch (phase) {
+	case RENDER_PHASE_CLEAR:
+		return "clear";
+	case RENDER_PHASE_LAYERS:
+		return "layers";
+	case RENDER_PHASE_WORKSPACE:
+		return "workspace";
+	case RENDER_PHASE_FLOATING:
+		return "floating";
+	case RENDER_PHASE_POPUPS:
+		return "popups";
+	case RENDER_PHASE_CURSORS:
+		return "cursors";
+	case RENDER_PHASE_COMMIT:
+		return "commit";
+	case RENDER_PHASE_COUNT:
+		break;
+	}
+	return "unknown";
+}
+
+void adaptive_render_time_reset(struct adaptive_render_time *art) {
+	memset(art, 0, sizeof(struct adaptive_render_time));
+}
+
+static int compare_uint32(const void *a, const void *b) {
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+int adaptive_render_time_update(struct adaptive_render_time *art,
+		uint32_t usec, bool missed, uint32_t refresh_nsec) {
+	art->samples_usec[art->next] = usec;
+	art->next = (art->next + 1) % ADAPTIVE_RENDER_TIME_SAMPLES;
+	if (art->nsamples < ADAPTIVE_RENDER_TIME_SAMPLES) {
+		art->nsamples++;
+	}
+
+	if (missed) {
+		if (art->backoff_msec < ADAPTIVE_RENDER_TIME_MAX_BACKOFF_MSEC) {
+			art->backoff_msec++;
+		}
+		art->good_frames = 0;
+	} else if (++art->good_frames >= ADAPTIVE_RENDER_TIME_DECAY_FRAMES) {
+		if (art->backoff_msec > 0) {
+			art->backoff_msec--;
+		}
+		art->good_frames = 0;
+	}
+
+	if (refresh_nsec == 0 ||
+			art->nsamples < ADAPTIVE_RENDER_TIME_MIN_SAMPLES) {
+		return 0;
+	}
+
+	uint32_t sorted[ADAPTIVE_RENDER_TIME_SAMPLES];
+	memcpy(sorted, art->samples_usec, art->nsamples * sizeof(uint32_t));
+	qsort(sorted, art->nsamples, sizeof(uint32_t), compare_uint32);
+	uint32_t percentile = sorted[(art->nsamples - 1) *
+		ADAPTIVE_RENDER_TIME_PERCENTILE / 100];
+
+	// Round up, it's better to start a little early than to miss the refresh
+	int msec = (percentile + ADAPTIVE_RENDER_TIME_MARGIN_USEC + 999) / 1000 +
+		art->backoff_msec;
+	if (msec >= (int)(refresh_nsec / 1000000)) {
+		return 0;
+	}
+	return msec;
+}
@@ -23,6 +23,10 @@ static int surface_frame_done_timer_handler(void *data) {
 
 	struct timespec now;
 	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (!wl_list_empty(&surface->wlr_surface->current.frame_callback_list)) {
+		surface->frame_done_time = now;
+		surface->frame_done_pending = true;
+	}
 	wlr_surface_send_frame_done(surface->wlr_surface, &now);
 
 	return 0;
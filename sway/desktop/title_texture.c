@@ -0,0 +1,212 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <wayland-server-core.h>
+#include <wlr/backend.h>
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/render/wlr_texture.h>
+#include "cairo.h"
+#include "pango.h"
+#include "log.h"
+#include "sway/config.h"
+#include "sway/desktop/title_texture.h"
+#include "sway/output.h"
+
+static struct {
+	struct wl_list entries; // sway_title_texture::link
+	size_t size;
+	bool initialized;
+} cache;
+
+static uint32_t hash_bytes(uint32_t hash, const void *data, size_t len) {
+	const unsigned char *bytes = data;
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static uint32_t hash_key(const char *text, const char *font, bool pango_markup,
+		int height, double scale, enum wl_output_subpixel subpixel,
+		struct border_colors *class) {
+	uint32_t hash = 2166136261u;
+	hash = hash_bytes(hash, text, strlen(text));
+	hash = hash_bytes(hash, font, strlen(font));
+	hash = hash_bytes(hash, &pango_markup, sizeof(pango_markup));
+	hash = hash_bytes(hash, &height, sizeof(height));
+	hash = hash_bytes(hash, &scale, sizeof(scale));
+	hash = hash_bytes(hash, &subpixel, sizeof(subpixel));
+	hash = hash_bytes(hash, class->background, sizeof(class->background));
+	hash = hash_bytes(hash, class->text, sizeof(class->text));
+	return hash;
+}
+
+static bool title_texture_matches(struct sway_title_texture *title,
+		uint32_t hash, const char *text, const char *font, bool pango_markup,
+		int height, double scale, enum wl_output_subpixel subpixel,
+		struct border_colors *class, struct wlr_renderer *renderer) {
+	return title->hash == hash &&
+		title->renderer == renderer &&
+		title->pango_markup == pango_markup &&
+		title->height == height &&
+		title->scale == scale &&
+		title->subpixel == subpixel &&
+		memcmp(title->background, class->background,
+				sizeof(title->background)) == 0 &&
+		memcmp(title->foreground, class->text,
+				sizeof(title->foreground)) == 0 &&
+		strcmp(title->text, text) == 0 &&
+		strcmp(title->font, font) == 0;
+}
+
+static void title_texture_destroy(struct sway_title_texture *title) {
+	wl_list_remove(&title->link);
+	cache.size -= title->size;
+	wlr_texture_destroy(title->texture);
+	free(title->text);
+	free(title->font);
+	free(title);
+}
+
+static void cache_evict(void) {
+	struct sway_title_texture *title, *tmp;
+	wl_list_for_each_reverse_safe(title, tmp, &cache.entries, link) {
+		if (cache.size <= TITLE_TEXTURE_CACHE_MAX_SIZE) {
+			break;
+		}
+		if (title->refcount == 0) {
+			title_texture_destroy(title);
+		}
+	}
+}
+
+static struct wlr_texture *render_title_texture(struct sway_output *output,
+		const char *text, bool pango_markup, int height,
+		struct border_colors *class) {
+	double scale = output->wlr_output->scale;
+	int width = 0;
+	height *= scale;
+
+	// We must use a non-nil cairo_t for cairo_set_font_options to work.
+	// Therefore, we cannot use cairo_create(NULL).
+	cairo_surface_t *dummy_surface = cairo_image_surface_create(
+			CAIRO_FORMAT_ARGB32, 0, 0);
+	cairo_t *c = cairo_create(dummy_surface);
+	cairo_set_antialias(c, CAIRO_ANTIALIAS_BEST);
+	cairo_font_options_t *fo = cairo_font_options_create();
+	cairo_font_options_set_hint_style(fo, CAIRO_HINT_STYLE_FULL);
+	if (output->wlr_output->subpixel == WL_OUTPUT_SUBPIXEL_NONE) {
+		cairo_font_options_set_antialias(fo, CAIRO_ANTIALIAS_GRAY);
+	} else {
+		cairo_font_options_set_antialias(fo, CAIRO_ANTIALIAS_SUBPIXEL);
+		cairo_font_options_set_subpixel_order(fo,
+			to_cairo_subpixel_order(output->wlr_output->subpixel));
+	}
+	cairo_set_font_options(c, fo);
+	get_text_size(c, config->font, &width, NULL, NULL, scale,
+			pango_markup, "%s", text);
+	cairo_surface_destroy(dummy_surface);
+	cairo_destroy(c);
+
+	cairo_surface_t *surface = cairo_image_surface_create(
+			CAIRO_FORMAT_ARGB32, width, height);
+	cairo_t *cairo = cairo_create(surface);
+	cairo_set_antialias(cairo, CAIRO_ANTIALIAS_BEST);
+	cairo_set_font_options(cairo, fo);
+	cairo_font_options_destroy(fo);
+	cairo_set_source_rgba(cairo, class->background[0], class->background[1],
+			class->background[2], class->background[3]);
+	cairo_paint(cairo);
+	PangoContext *pango = pango_cairo_create_context(cairo);
+	cairo_set_source_rgba(cairo, class->text[0], class->text[1],
+			class->text[2], class->text[3]);
+	cairo_move_to(cairo, 0, 0);
+
+	pango_printf(cairo, config->font, scale, pango_markup, "%s", text);
+
+	cairo_surface_flush(surface);
+	unsigned char *data = cairo_image_surface_get_data(surface);
+	int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
+	struct wlr_renderer *renderer = wlr_backend_get_renderer(
+			output->wlr_output->backend);
+	struct wlr_texture *texture = wlr_texture_from_pixels(
+			renderer, WL_SHM_FORMAT_ARGB8888, stride, width, height, data);
+	cairo_surface_destroy(surface);
+	g_object_unref(pango);
+	cairo_destroy(cairo);
+	return texture;
+}
+
+struct sway_title_texture *title_texture_get(struct sway_output *output,
+		const char *text, bool pango_markup, int height,
+		struct border_colors *class) {
+	if (!cache.initialized) {
+		wl_list_init(&cache.entries);
+		cache.initialized = true;
+	}
+
+	struct wlr_renderer *renderer = wlr_backend_get_renderer(
+			output->wlr_output->backend);
+	double scale = output->wlr_output->scale;
+	enum wl_output_subpixel subpixel = output->wlr_output->subpixel;
+	uint32_t hash = hash_key(text, config->font, pango_markup, height, scale,
+			subpixel, class);
+
+	struct sway_title_texture *title;
+	wl_list_for_each(title, &cache.entries, link) {
+		if (title_texture_matches(title, hash, text, config->font,
+					pango_markup, height, scale, subpixel, class, renderer)) {
+			wl_list_remove(&title->link);
+			wl_list_insert(&cache.entries, &title->link);
+			title->refcount++;
+			return title;
+		}
+	}
+
+	struct wlr_texture *texture = render_title_texture(output, text,
+			pango_markup, height, class);
+	if (!texture) {
+		return NULL;
+	}
+
+	title = calloc(1, sizeof(struct sway_title_texture));
+	if (!sway_assert(title, "Unable to allocate title texture")) {
+		wlr_texture_destroy(texture);
+		return NULL;
+	}
+	title->texture = texture;
+	title->hash = hash;
+	title->text = strdup(text);
+	title->font = strdup(config->font);
+	title->pango_markup = pango_markup;
+	title->height = height;
+	title->scale = scale;
+	title->subpixel = subpixel;
+	memcpy(title->background, class->background, sizeof(title->background));
+	memcpy(title->foreground, class->text, sizeof(title->foreground));
+	title->renderer = renderer;
+	title->refcount = 1;
+
+	int width, texture_height;
+	wlr_texture_get_size(texture, &width, &texture_height);
+	title->size = (size_t)width * texture_height * 4;
+
+	wl_list_insert(&cache.entries, &title->link);
+	cache.size += title->size;
+	cache_evict();
+	return title;
+}
+
+void title_texture_unref(struct sway_title_texture *title) {
+	if (!title) {
+		return;
+	}
+	if (!sway_assert(title->refcount > 0, "Title texture refcount underflow")) {
+		return;
+	}
+	title->refcount--;
+	if (title->refcount == 0) {
+		cache_evict();
+	}
+}
@@ -10,6 +10,7 @@
 #include "sway/desktop/transaction.h"
 #include "sway/input/cursor.h"
 #include "sway/input/input-manager.h"
+#include "sway/ipc-server.h"
 #include "sway/output.h"
 #include "sway/tree/container.h"
 #include "sway/tree/node.h"
@@ -19,11 +20,14 @@
 #include "log.h"
 
 struct sway_transaction {
+	uint64_t id;
 	struct wl_event_source *timer;
+	bool applied;
 	list_t *instructions;   // struct sway_transaction_instruction *
 	size_t num_waiting;
 	size_t num_configures;
 	struct timespec commit_time;
+	bool committed;
 };
 
 struct sway_transaction_instruction {
@@ -35,14 +39,246 @@ struct sway_transaction_instruction {
 		struct sway_container_state container_state;
 	};
 	uint32_t serial;
+	bool waiting; // Counted in the transaction's num_waiting
+	bool slow; // Configured, but not waited for because the client is slow
+	bool ready;
 };
 
+// A client is considered slow once its average configure latency reaches
+// this share of the transaction timeout, or it times out this many times in
+// a row. It's waited for again once its average drops below half of it.
+#define SLOW_CLIENT_LATENCY_PERCENT 75
+#define SLOW_CLIENT_TIMEOUTS 3
+#define SLOW_CLIENT_MIN_SAMPLES 4
+// Weight of a new sample in the moving average
+#define CLIENT_LATENCY_WEIGHT 0.2f
+
+static const char *view_client_id(struct sway_view *view) {
+	const char *id = view_get_app_id(view);
+	if (!id) {
+		id = view_get_class(view);
+	}
+	return id;
+}
+
+static struct sway_txn_client_stats *get_client_stats(struct sway_view *view,
+		bool create) {
+	const char *id = view_client_id(view);
+	if (!id) {
+		return NULL;
+	}
+	for (int i = 0; i < server.txn_client_stats->length; ++i) {
+		struct sway_txn_client_stats *stats = server.txn_client_stats->items[i];
+		if (strcmp(stats->app_id, id) == 0) {
+			return stats;
+		}
+	}
+	if (!create) {
+		return NULL;
+	}
+	struct sway_txn_client_stats *stats =
+		calloc(1, sizeof(struct sway_txn_client_stats));
+	if (!sway_assert(stats, "Unable to allocate client stats")) {
+		return NULL;
+	}
+	stats->app_id = strdup(id);
+	list_add(server.txn_client_stats, stats);
+	return stats;
+}
+
+const struct sway_txn_client_stats *transaction_get_client_stats(
+		struct sway_view *view) {
+	return get_client_stats(view, false);
+}
+
+static void update_client_slow(struct sway_txn_client_stats *stats,
+		struct sway_view *view) {
+	float threshold =
+		server.txn_timeout_ms * SLOW_CLIENT_LATENCY_PERCENT / 100.0f;
+	bool slow = stats->slow;
+	if (stats->consecutive_timeouts >= SLOW_CLIENT_TIMEOUTS ||
+			(stats->samples >= SLOW_CLIENT_MIN_SAMPLES &&
+			 stats->latency_ms >= threshold)) {
+		slow = true;
+	} else if (stats->consecutive_timeouts == 0 &&
+			stats->latency_ms < threshold / 2) {
+		slow = false;
+	}
+	if (slow != stats->slow) {
+		sway_log(SWAY_DEBUG, "Client %s is %s (%.1fms average latency, "
+				"%u timeouts in a row)", stats->app_id,
+				slow ? "slow, no longer waiting for it" : "responsive again",
+				stats->latency_ms, stats->consecutive_timeouts);
+		stats->slow = slow;
+	}
+}
+
+static void record_client_latency(struct sway_view *view, float ms,
+		bool timed_out) {
+	if (debug.noquarantine) {
+		return;
+	}
+	struct sway_txn_client_stats *stats = get_client_stats(view, true);
+	if (!stats) {
+		return;
+	}
+	if (stats->samples == 0) {
+		stats->latency_ms = ms;
+	} else {
+		stats->latency_ms += (ms - stats->latency_ms) * CLIENT_LATENCY_WEIGHT;
+	}
+	stats->samples++;
+	if (timed_out) {
+		stats->timeouts++;
+		stats->consecutive_timeouts++;
+	} else {
+		stats->consecutive_timeouts = 0;
+	}
+	update_client_slow(stats, view);
+}
+
+static bool view_is_slow(struct sway_view *view) {
+	if (debug.noquarantine) {
+		return false;
+	}
+	struct sway_txn_client_stats *stats = get_client_stats(view, false);
+	return stats && stats->slow;
+}
+
+static float get_elapsed_ms(const struct timespec *start) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000 +
+		(now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+/**
+ * Instructions are recycled rather than freed, since a relayout of a large
+ * tree goes through hundreds of them.
+ */
+#define INSTRUCTION_POOL_SIZE 256
+
+static struct {
+	struct sway_transaction_instruction *items[INSTRUCTION_POOL_SIZE];
+	int length;
+} instruction_pool;
+
+static struct sway_transaction_instruction *instruction_alloc(void) {
+	if (instruction_pool.length == 0) {
+		return calloc(1, sizeof(struct sway_transaction_instruction));
+	}
+	struct sway_transaction_instruction *instruction =
+		instruction_pool.items[--instruction_pool.length];
+	memset(instruction, 0, sizeof(struct sway_transaction_instruction));
+	return instruction;
+}
+
+static void instruction_free(struct sway_transaction_instruction *instruction) {
+	if (instruction_pool.length < INSTRUCTION_POOL_SIZE) {
+		instruction_pool.items[instruction_pool.length++] = instruction;
+	} else {
+		free(instruction);
+	}
+}
+
+/**
+ * Drop the references to the lists of an instruction which was never applied.
+ * Applied instructions hand their lists over to the node's current state.
+ */
+static void instruction_release_lists(
+		struct sway_transaction_instruction *instruction) {
+	switch (instruction->node->type) {
+	case N_ROOT:
+		break;
+	case N_OUTPUT:
+		node_state_list_unref(instruction->output_state.workspaces);
+		break;
+	case N_WORKSPACE:
+		node_state_list_unref(instruction->workspace_state.floating);
+		node_state_list_unref(instruction->workspace_state.tiling);
+		break;
+	case N_CONTAINER:
+		node_state_list_unref(instruction->container_state.children);
+		break;
+	}
+}
+
+static struct {
+	struct transaction_trace_event events[TRANSACTION_TRACE_SIZE];
+	size_t next, length;
+} trace;
+
+static struct transaction_trace_event *trace_event(
+		enum transaction_trace_type type,
+		struct sway_transaction *transaction, struct sway_node *node) {
+	struct transaction_trace_event *event = &trace.events[trace.next];
+	memset(event, 0, sizeof(struct transaction_trace_event));
+	event->type = type;
+	clock_gettime(CLOCK_MONOTONIC, &event->time);
+	event->transaction = transaction ? transaction->id : 0;
+	event->node_id = node ? node->id : 0;
+
+	trace.next = (trace.next + 1) % TRANSACTION_TRACE_SIZE;
+	if (trace.length < TRANSACTION_TRACE_SIZE) {
+		trace.length++;
+	}
+	return event;
+}
+
+static void trace_instruction(enum transaction_trace_type type,
+		struct sway_transaction_instruction *instruction) {
+	struct transaction_trace_event *event =
+		trace_event(type, instruction->transaction, instruction->node);
+	event->serial = instruction->serial;
+	if (type == TXN_TRACE_CONFIGURE) {
+		event->width = instruction->container_state.content_width;
+		event->height = instruction->container_state.content_height;
+	}
+}
+
+void transaction_trace_for_each(
+		void (*f)(const struct transaction_trace_event *event, void *data),
+		void *data) {
+	size_t start = (trace.next + TRANSACTION_TRACE_SIZE - trace.length) %
+		TRANSACTION_TRACE_SIZE;
+	for (size_t i = 0; i < trace.length; ++i) {
+		f(&trace.events[(start + i) % TRANSACTION_TRACE_SIZE], data);
+	}
+}
+
+void transaction_trace_clear(void) {
+	trace.next = 0;
+	trace.length = 0;
+}
+
+const char *transaction_trace_type_to_str(enum transaction_trace_type type) {
+	switch (type) {
+	case TXN_TRACE_QUEUE:
+		return "queue";
+	case TXN_TRACE_COMMIT:
+		return "commit";
+	case TXN_TRACE_CONFIGURE:
+		return "configure";
+	case TXN_TRACE_READY:
+		return "ready";
+	case TXN_TRACE_LATE_READY:
+		return "late_ready";
+	case TXN_TRACE_TIMEOUT:
+		return "timeout";
+	case TXN_TRACE_APPLY:
+		return "apply";
+	}
+	return "unknown";
+}
+
 static struct sway_transaction *transaction_create(void) {
+	static uint64_t next_id = 1;
 	struct sway_transaction *transaction =
 		calloc(1, sizeof(struct sway_transaction));
 	if (!sway_assert(transaction, "Unable to allocate transaction")) {
 		return NULL;
 	}
+	transaction->id = next_id++;
 	transaction->instructions = create_list();
 	return transaction;
 }
@@ -53,6 +289,9 @@ static void transaction_destroy(struct sway_transaction *transaction) {
 		struct sway_transaction_instruction *instruction =
 			transaction->instructions->items[i];
 		struct sway_node *node = instruction->node;
+		if (!transaction->applied) {
+			instruction_release_lists(instruction);
+		}
 		node->ntxnrefs--;
 		if (node->instruction == instruction) {
 			node->instruction = NULL;
@@ -73,7 +312,7 @@ static void transaction_destroy(struct sway_transaction *transaction) {
 				break;
 			}
 		}
-		free(instruction);
+		instruction_free(instruction);
 	}
 	list_free(transaction->instructions);
 
@@ -86,8 +325,8 @@ static void transaction_destroy(struct sway_transaction *transaction) {
 static void copy_output_state(struct sway_output *output,
 		struct sway_transaction_instruction *instruction) {
 	struct sway_output_state *state = &instruction->output_state;
-	state->workspaces = create_list();
-	list_cat(state->workspaces, output->workspaces);
+	state->workspaces = node_state_list_share(output->current.workspaces,
+		output->workspaces);
 
 	state->active_workspace = output_get_active_workspace(output);
 }
@@ -104,10 +343,8 @@ static void copy_workspace_state(struct sway_workspace *ws,
 	state->layout = ws->layout;
 
 	state->output = ws->output;
-	state->floating = create_list();
-	state->tiling = create_list();
-	list_cat(state->floating, ws->floating);
-	list_cat(state->tiling, ws->tiling);
+	state->floating = node_state_list_share(ws->current.floating, ws->floating);
+	state->tiling = node_state_list_share(ws->current.tiling, ws->tiling);
 
 	struct sway_seat *seat = input_manager_current_seat();
 	state->focused = seat_get_focus(seat) == &ws->node;
@@ -146,8 +383,8 @@ static void copy_container_state(struct sway_container *container,
 	state->content_height = container->content_height;
 
 	if (!container->view) {
-		state->children = create_list();
-		list_cat(state->children, container->children);
+		state->children = node_state_list_share(container->current.children,
+			container->children);
 	}
 
 	struct sway_seat *seat = input_manager_current_seat();
@@ -162,8 +399,7 @@ static void copy_container_state(struct sway_container *container,
 
 static void transaction_add_node(struct sway_transaction *transaction,
 		struct sway_node *node) {
-	struct sway_transaction_instruction *instruction =
-		calloc(1, sizeof(struct sway_transaction_instruction));
+	struct sway_transaction_instruction *instruction = instruction_alloc();
 	if (!sway_assert(instruction, "Unable to allocate instruction")) {
 		return;
 	}
@@ -191,7 +427,7 @@ static void transaction_add_node(struct sway_transaction *transaction,
 static void apply_output_state(struct sway_output *output,
 		struct sway_output_state *state) {
 	output_damage_whole(output);
-	list_free(output->current.workspaces);
+	node_state_list_unref(output->current.workspaces);
 	memcpy(&output->current, state, sizeof(struct sway_output_state));
 	output_damage_whole(output);
 }
@@ -199,14 +435,15 @@ static void apply_output_state(struct sway_output *output,
 static void apply_workspace_state(struct sway_workspace *ws,
 		struct sway_workspace_state *state) {
 	output_damage_whole(ws->current.output);
-	list_free(ws->current.floating);
-	list_free(ws->current.tiling);
+	node_state_list_unref(ws->current.floating);
+	node_state_list_unref(ws->current.tiling);
 	memcpy(&ws->current, state, sizeof(struct sway_workspace_state));
 	output_damage_whole(ws->current.output);
 }
 
 static void apply_container_state(struct sway_container *container,
-		struct sway_container_state *state) {
+		struct sway_transaction_instruction *instruction) {
+	struct sway_container_state *state = &instruction->container_state;
 	struct sway_view *view = container->view;
 	// Damage the old location
 	desktop_damage_whole_container(container);
@@ -223,18 +460,29 @@ static void apply_container_state(struct sway_container *container,
 		}
 	}
 
-	// There are separate children lists for each instruction state, the
-	// container's current state and the container's pending state
-	// (ie. con->children). The list itself needs to be freed here.
-	// Any child containers which are being deleted will be cleaned up in
-	// transaction_destroy().
-	list_free(container->current.children);
+	// The children lists of instruction states and the container's current
+	// state are shared when they hold the same children, and are separate
+	// from the pending state (ie. con->children). The current state's
+	// reference is dropped here. Any child containers which are being deleted
+	// will be cleaned up in transaction_destroy().
+	node_state_list_unref(container->current.children);
 
 	memcpy(&container->current, state, sizeof(struct sway_container_state));
 
 	if (view && !wl_list_empty(&view->saved_buffers)) {
-		if (!container->node.destroying || container->node.ntxnrefs == 1) {
+		if (instruction->slow && !instruction->ready &&
+				!container->node.destroying) {
+			// Keep showing the old contents, scaled to the new size, until
+			// the slow client catches up
+			view->late_configure.pending = true;
+			view->late_configure.serial = instruction->serial;
+			view->late_configure.width = state->content_width;
+			view->late_configure.height = state->content_height;
+			view->late_configure.time = instruction->transaction->commit_time;
+		} else if (!container->node.destroying ||
+				container->node.ntxnrefs == 1) {
 			view_remove_saved_buffer(view);
+			view->late_configure.pending = false;
 		}
 	}
 
@@ -274,11 +522,19 @@ static void apply_container_state(struct sway_container *container,
 	}
 }
 
+static void update_decorations(list_t *containers) {
+	for (int i = 0; i < containers->length; ++i) {
+		container_update_decorations(containers->items[i]);
+	}
+}
+
 /**
  * Apply a transaction to the "current" state of the tree.
  */
 static void transaction_apply(struct sway_transaction *transaction) {
 	sway_log(SWAY_DEBUG, "Applying transaction %p", transaction);
+	transaction->applied = true;
+	trace_event(TXN_TRACE_APPLY, transaction, NULL);
 	if (debug.txn_timings) {
 		struct timespec now;
 		clock_gettime(CLOCK_MONOTONIC, &now);
@@ -306,78 +562,182 @@ static void transaction_apply(struct sway_transaction *transaction) {
 					&instruction->workspace_state);
 			break;
 		case N_CONTAINER:
-			apply_container_state(node->sway_container,
-					&instruction->container_state);
+			apply_container_state(node->sway_container, instruction);
 			break;
 		}
 
+		// The description includes some current state, such as borders
+		node_invalidate_ipc_json(node);
+		ipc_tree_delta_add(node);
 		node->instruction = NULL;
 	}
 
+	// Decoration geometry depends on the parent and siblings, so it can only
+	// be worked out once every instruction has been applied
+	for (int i = 0; i < transaction->instructions->length; ++i) {
+		struct sway_transaction_instruction *instruction =
+			transaction->instructions->items[i];
+		struct sway_node *node = instruction->node;
+
+		switch (node->type) {
+		case N_ROOT:
+		case N_OUTPUT:
+			break;
+		case N_WORKSPACE:
+			update_decorations(node->sway_workspace->current.tiling);
+			update_decorations(node->sway_workspace->current.floating);
+			break;
+		case N_CONTAINER:
+			container_update_decorations(node->sway_container);
+			if (node->sway_container->current.children) {
+				update_decorations(node->sway_container->current.children);
+			}
+			break;
+		}
+	}
+
 	cursor_rebase_all();
+	ipc_event_tree_delta();
 }
 
 static void transaction_commit(struct sway_transaction *transaction);
 
-// Return true if both transactions operate on the same nodes
-static bool transaction_same_nodes(struct sway_transaction *a,
-		struct sway_transaction *b) {
-	if (a->instructions->length != b->instructions->length) {
-		return false;
+static uint32_t node_mark;
+
+static void transaction_mark_nodes(struct sway_transaction *transaction,
+		uint32_t mark) {
+	for (int i = 0; i < transaction->instructions->length; ++i) {
+		struct sway_transaction_instruction *instruction =
+			transaction->instructions->items[i];
+		instruction->node->txn_mark = mark;
+	}
+}
+
+static bool transaction_has_marked_nodes(struct sway_transaction *transaction,
+		uint32_t mark) {
+	for (int i = 0; i < transaction->instructions->length; ++i) {
+		struct sway_transaction_instruction *instruction =
+			transaction->instructions->items[i];
+		if (instruction->node->txn_mark == mark) {
+			return true;
+		}
 	}
-	for (int i = 0; i < a->instructions->length; ++i) {
-		struct sway_transaction_instruction *a_inst = a->instructions->items[i];
-		struct sway_transaction_instruction *b_inst = b->instructions->items[i];
-		if (a_inst->node != b_inst->node) {
-			return false;
+	return false;
+}
+
+/**
+ * Fold an uncommitted transaction into the uncommitted transaction queued
+ * right after it. Nodes in both keep the newer state, the others are moved
+ * over as they are. The older transaction is destroyed.
+ */
+static void transaction_merge(struct sway_transaction *older,
+		struct sway_transaction *newer) {
+	uint32_t mark = ++node_mark;
+	transaction_mark_nodes(newer, mark);
+
+	int kept = 0;
+	for (int i = 0; i < older->instructions->length; ++i) {
+		struct sway_transaction_instruction *instruction =
+			older->instructions->items[i];
+		if (instruction->node->txn_mark == mark) {
+			// Superseded, freed along with the older transaction
+			older->instructions->items[kept++] = instruction;
+		} else {
+			instruction->transaction = newer;
+			list_add(newer->instructions, instruction);
+		}
+	}
+	older->instructions->length = kept;
+	transaction_destroy(older);
+}
+
+static void transaction_apply_ready(void) {
+	for (int i = 0; i < server.transactions->length; ++i) {
+		struct sway_transaction *transaction = server.transactions->items[i];
+		if (transaction->committed && !transaction->num_waiting) {
+			transaction_apply(transaction);
+			transaction_destroy(transaction);
+			list_del(server.transactions, i--);
 		}
 	}
-	return true;
+}
+
+/**
+ * Merge neighbouring uncommitted transactions which share nodes, so each
+ * node only has one state waiting to be committed.
+ */
+static void transaction_merge_queued(void) {
+	int i = 0;
+	while (i + 1 < server.transactions->length) {
+		struct sway_transaction *a = server.transactions->items[i];
+		struct sway_transaction *b = server.transactions->items[i + 1];
+		uint32_t mark = ++node_mark;
+		transaction_mark_nodes(a, mark);
+		if (!a->committed && !b->committed &&
+				transaction_has_marked_nodes(b, mark)) {
+			list_del(server.transactions, i);
+			transaction_merge(a, b);
+		} else {
+			++i;
+		}
+	}
+}
+
+/**
+ * Commit every queued transaction which doesn't share nodes with any
+ * transaction ahead of it. Transactions on disjoint sets of nodes are
+ * independent, so a slow client only holds back the transactions which
+ * touch its own view. Returns true if one of them is ready right away.
+ */
+static bool transaction_commit_independent(void) {
+	bool ready = false;
+	uint32_t mark = ++node_mark;
+	for (int i = 0; i < server.transactions->length; ++i) {
+		struct sway_transaction *transaction = server.transactions->items[i];
+		if (!transaction->committed &&
+				!transaction_has_marked_nodes(transaction, mark)) {
+			transaction_commit(transaction);
+			ready = ready || !transaction->num_waiting;
+		}
+		transaction_mark_nodes(transaction, mark);
+	}
+	return ready;
 }
 
 static void transaction_progress_queue(void) {
 	if (!server.transactions->length) {
 		return;
 	}
-	// Only the first transaction in the queue is committed, so that's the one
-	// we try to process.
-	struct sway_transaction *transaction = server.transactions->items[0];
-	if (transaction->num_waiting) {
-		return;
-	}
-	transaction_apply(transaction);
-	transaction_destroy(transaction);
-	list_del(server.transactions, 0);
+
+	bool ready;
+	do {
+		transaction_apply_ready();
+		transaction_merge_queued();
+		ready = transaction_commit_independent();
+	} while (ready);
 
 	if (server.transactions->length == 0) {
 		// The transaction queue is empty, so we're done.
 		sway_idle_inhibit_v1_check_active(server.idle_inhibit_manager_v1);
-		return;
-	}
-
-	// If there's a bunch of consecutive transactions which all apply to the
-	// same views, skip all except the last one.
-	while (server.transactions->length >= 2) {
-		struct sway_transaction *a = server.transactions->items[0];
-		struct sway_transaction *b = server.transactions->items[1];
-		if (transaction_same_nodes(a, b)) {
-			list_del(server.transactions, 0);
-			transaction_destroy(a);
-		} else {
-			break;
-		}
 	}
-
-	// We again commit the first transaction in the queue to process it.
-	transaction = server.transactions->items[0];
-	transaction_commit(transaction);
-	transaction_progress_queue();
 }
 
 static int handle_timeout(void *data) {
 	struct sway_transaction *transaction = data;
 	sway_log(SWAY_DEBUG, "Transaction %p timed out (%zi waiting)",
 			transaction, transaction->num_waiting);
+	for (int i = 0; i < transaction->instructions->length; ++i) {
+		struct sway_transaction_instruction *instruction =
+			transaction->instructions->items[i];
+		if (instruction->waiting) {
+			instruction->waiting = false;
+			trace_instruction(TXN_TRACE_TIMEOUT, instruction);
+			if (!instruction->node->destroying) {
+				record_client_latency(instruction->node->sway_container->view,
+					server.txn_timeout_ms, true);
+			}
+		}
+	}
 	transaction->num_waiting = 0;
 	transaction_progress_queue();
 	return 0;
@@ -413,7 +773,9 @@ static bool should_configure(struct sway_node *node,
 static void transaction_commit(struct sway_transaction *transaction) {
 	sway_log(SWAY_DEBUG, "Transaction %p committing with %i instructions",
 			transaction, transaction->instructions->length);
+	transaction->committed = true;
 	transaction->num_waiting = 0;
+	trace_event(TXN_TRACE_COMMIT, transaction, NULL);
 	for (int i = 0; i < transaction->instructions->length; ++i) {
 		struct sway_transaction_instruction *instruction =
 			transaction->instructions->items[i];
@@ -424,7 +786,13 @@ static void transaction_commit(struct sway_transaction *transaction) {
 					instruction->container_state.content_y,
 					instruction->container_state.content_width,
 					instruction->container_state.content_height);
-			++transaction->num_waiting;
+			trace_instruction(TXN_TRACE_CONFIGURE, instruction);
+			if (view_is_slow(node->sway_container->view)) {
+				instruction->slow = true;
+			} else {
+				instruction->waiting = true;
+				++transaction->num_waiting;
+			}
 
 			// From here on we are rendering a saved buffer of the view, which
 			// means we can send a frame done event to make the client redraw it
@@ -444,9 +812,7 @@ static void transaction_commit(struct sway_transaction *transaction) {
 		node->instruction = instruction;
 	}
 	transaction->num_configures = transaction->num_waiting;
-	if (debug.txn_timings) {
-		clock_gettime(CLOCK_MONOTONIC, &transaction->commit_time);
-	}
+	clock_gettime(CLOCK_MONOTONIC, &transaction->commit_time);
 	if (debug.noatomic) {
 		transaction->num_waiting = 0;
 	} else if (debug.txn_wait) {
@@ -474,12 +840,9 @@ static void set_instruction_ready(
 		struct sway_transaction_instruction *instruction) {
 	struct sway_transaction *transaction = instruction->transaction;
 
+	trace_instruction(TXN_TRACE_READY, instruction);
+	float ms = get_elapsed_ms(&transaction->commit_time);
 	if (debug.txn_timings) {
-		struct timespec now;
-		clock_gettime(CLOCK_MONOTONIC, &now);
-		struct timespec *start = &transaction->commit_time;
-		float ms = (now.tv_sec - start->tv_sec) * 1000 +
-			(now.tv_nsec - start->tv_nsec) / 1000000.0;
 		sway_log(SWAY_DEBUG, "Transaction %p: %zi/%zi ready in %.1fms (%s)",
 				transaction,
 				transaction->num_configures - transaction->num_waiting + 1,
@@ -487,22 +850,56 @@ static void set_instruction_ready(
 				instruction->node->sway_container->title);
 	}
 
-	// If the transaction has timed out then its num_waiting will be 0 already.
-	if (transaction->num_waiting > 0 && --transaction->num_waiting == 0) {
-		sway_log(SWAY_DEBUG, "Transaction %p is ready", transaction);
-		wl_event_source_timer_update(transaction->timer, 0);
+	// Late replies after a timeout have been accounted for already
+	if (instruction->waiting || instruction->slow) {
+		record_client_latency(instruction->node->sway_container->view,
+			ms, false);
+	}
+	instruction->ready = true;
+
+	// If the transaction has timed out then the instruction isn't waited for
+	// anymore, and neither are instructions of slow clients.
+	if (instruction->waiting) {
+		instruction->waiting = false;
+		if (--transaction->num_waiting == 0) {
+			sway_log(SWAY_DEBUG, "Transaction %p is ready", transaction);
+			wl_event_source_timer_update(transaction->timer, 0);
+		}
 	}
 
 	instruction->node->instruction = NULL;
 	transaction_progress_queue();
 }
 
+/**
+ * A slow client has caught up with a configure from a transaction which was
+ * applied without waiting for it.
+ */
+static void set_late_configure_ready(struct sway_view *view) {
+	view->late_configure.pending = false;
+	struct transaction_trace_event *event =
+		trace_event(TXN_TRACE_LATE_READY, NULL, &view->container->node);
+	event->serial = view->late_configure.serial;
+	record_client_latency(view, get_elapsed_ms(&view->late_configure.time),
+		false);
+
+	// A newer transaction in flight still needs the saved buffer
+	if (view->container->node.instruction == NULL) {
+		desktop_damage_whole_container(view->container);
+		view_remove_saved_buffer(view);
+		desktop_damage_whole_container(view->container);
+	}
+}
+
 void transaction_notify_view_ready_by_serial(struct sway_view *view,
 		uint32_t serial) {
 	struct sway_transaction_instruction *instruction =
 		view->container->node.instruction;
 	if (instruction != NULL && instruction->serial == serial) {
 		set_instruction_ready(instruction);
+	} else if (view->late_configure.pending &&
+			view->late_configure.serial == serial) {
+		set_late_configure_ready(view);
 	}
 }
 
@@ -514,6 +911,10 @@ void transaction_notify_view_ready_by_size(struct sway_view *view,
 			instruction->container_state.content_width == width &&
 			instruction->container_state.content_height == height) {
 		set_instruction_ready(instruction);
+	} else if (view->late_configure.pending &&
+			view->late_configure.width == width &&
+			view->late_configure.height == height) {
+		set_late_configure_ready(view);
 	}
 }
 
@@ -532,13 +933,11 @@ void transaction_commit_dirty(void) {
 	}
 	server.dirty_nodes->length = 0;
 
+	trace_event(TXN_TRACE_QUEUE, transaction, NULL);
 	list_add(server.transactions, transaction);
 
-	// We only commit the first transaction added to the queue.
-	if (server.transactions->length == 1) {
-		transaction_commit(transaction);
-		// Attempting to progress the queue here is useful
-		// if the transaction has nothing to wait for.
-		transaction_progress_queue();
-	}
+	// The transaction is committed right away unless it shares nodes with a
+	// transaction which is still in flight. Attempting to progress the queue
+	// here is also useful if the transaction has nothing to wait for.
+	transaction_progress_queue();
 }
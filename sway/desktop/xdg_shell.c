@@ -289,6 +289,9 @@ static void handle_commit(struct wl_listener *listener, void *data) {
 		transaction_notify_view_ready_by_serial(view,
 				xdg_surface->configure_serial);
 	} else {
+		transaction_notify_view_ready_by_serial(view,
+				xdg_surface->configure_serial);
+
 		struct wlr_box new_geo;
 		wlr_xdg_surface_get_geometry(xdg_surface, &new_geo);
 
@@ -309,6 +312,7 @@ static void handle_commit(struct wl_listener *listener, void *data) {
 		}
 	}
 
+	view_record_commit_latency(view);
 	view_damage_from(view);
 }
 
@@ -316,7 +320,7 @@ static void handle_set_title(struct wl_listener *listener, void *data) {
 	struct sway_xdg_shell_view *xdg_shell_view =
 		wl_container_of(listener, xdg_shell_view, set_title);
 	struct sway_view *view = &xdg_shell_view->view;
-	view_update_title(view, false);
+	view_queue_title_update(view);
 	view_execute_criteria(view);
 }
 
@@ -395,6 +395,7 @@ static void handle_commit(struct wl_listener *listener, void *data) {
 		}
 	}
 
+	view_record_commit_latency(view);
 	view_damage_from(view);
 }
 
@@ -581,7 +582,7 @@ static void handle_set_title(struct wl_listener *listener, void *data) {
 	if (!xsurface->mapped) {
 		return;
 	}
-	view_update_title(view, false);
+	view_queue_title_update(view);
 	view_execute_criteria(view);
 }
 
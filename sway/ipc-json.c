@@ -1,7 +1,12 @@
+#define _POSIX_C_SOURCE 200809L
 #include <json.h>
 #include <libevdev/libevdev.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
+#include <time.h>
+#include <unistd.h>
 #include "config.h"
 #include "log.h"
 #include "sway/config.h"
@@ -19,6 +24,7 @@
 #include <xkbcommon/xkbcommon.h>
 #include "wlr-layer-shell-unstable-v1-protocol.h"
 #include "sway/desktop/idle_inhibit_v1.h"
+#include "sway/desktop/transaction.h"
 
 static const int i3_output_id = INT32_MAX;
 static const int i3_scratch_id = INT32_MAX - 1;
@@ -229,6 +235,8 @@ static json_object *ipc_json_create_node(int id, char *name,
 
 static void ipc_json_describe_root(struct sway_root *root, json_object *object) {
 	json_object_object_add(object, "type", json_object_new_string("root"));
+	json_object_object_add(object, "generation",
+			json_object_new_int64(root->generation));
 }
 
 static void ipc_json_describe_output(struct sway_output *output,
@@ -308,6 +316,26 @@ static void ipc_json_describe_output(struct sway_output *output,
 	}
 
 	json_object_object_add(object, "max_render_time", json_object_new_int(output->max_render_time));
+	json_object_object_add(object, "max_render_time_adaptive",
+			json_object_new_boolean(output->max_render_time_adaptive));
+
+	json_object *scanout = json_object_new_object();
+	json_object_object_add(scanout, "status", json_object_new_string(
+			scanout_status_to_str(output->scanout_status)));
+	json_object_object_add(scanout, "frames_scanned_out",
+			json_object_new_int64(output->scanout_stats.scanned_out));
+	json_object_object_add(scanout, "frames_composited",
+			json_object_new_int64(output->scanout_stats.composited));
+	json_object *rejections = json_object_new_object();
+	for (int i = 0; i < SCANOUT_STATUS_COUNT; ++i) {
+		if (i == SCANOUT_OK || i == SCANOUT_NOT_FULLSCREEN) {
+			continue;
+		}
+		json_object_object_add(rejections, scanout_status_to_str(i),
+				json_object_new_int64(output->scanout_stats.rejected[i]));
+	}
+	json_object_object_add(scanout, "rejections", rejections);
+	json_object_object_add(object, "scanout", scanout);
 }
 
 json_object *ipc_json_describe_disabled_output(struct sway_output *output) {
@@ -357,7 +385,7 @@ json_object *ipc_json_describe_disabled_output(struct sway_output *output) {
 	return object;
 }
 
-static json_object *ipc_json_describe_scratchpad_output(void) {
+static json_object *ipc_json_create_scratchpad_workspace(void) {
 	struct wlr_box box;
 	root_get_box(root, &box);
 
@@ -374,17 +402,12 @@ static json_object *ipc_json_describe_scratchpad_output(void) {
 	json_object_object_add(workspace, "fullscreen_mode", json_object_new_int(1));
 	json_object_object_add(workspace, "type",
 			json_object_new_string("workspace"));
+	return workspace;
+}
 
-	// List all hidden scratchpad containers as floating nodes
-	json_object *floating_array = json_object_new_array();
-	for (int i = 0; i < root->scratchpad->length; ++i) {
-		struct sway_container *container = root->scratchpad->items[i];
-		if (container_is_scratchpad_hidden(container)) {
-			json_object_array_add(floating_array,
-				ipc_json_describe_node_recursive(&container->node));
-		}
-	}
-	json_object_object_add(workspace, "floating_nodes", floating_array);
+static json_object *ipc_json_create_scratchpad_output(void) {
+	struct wlr_box box;
+	root_get_box(root, &box);
 
 	// Create focus stack for __i3 output
 	json_object *output_focus = json_object_new_array();
@@ -396,7 +419,24 @@ static json_object *ipc_json_describe_scratchpad_output(void) {
 			json_object_new_string("output"));
 	json_object_object_add(output, "layout",
 			json_object_new_string("output"));
+	return output;
+}
 
+static json_object *ipc_json_describe_scratchpad_output(void) {
+	json_object *workspace = ipc_json_create_scratchpad_workspace();
+
+	// List all hidden scratchpad containers as floating nodes
+	json_object *floating_array = json_object_new_array();
+	for (int i = 0; i < root->scratchpad->length; ++i) {
+		struct sway_container *container = root->scratchpad->items[i];
+		if (container_is_scratchpad_hidden(container)) {
+			json_object_array_add(floating_array,
+				ipc_json_describe_node_recursive(&container->node));
+		}
+	}
+	json_object_object_add(workspace, "floating_nodes", floating_array);
+
+	json_object *output = ipc_json_create_scratchpad_output();
 	json_object *nodes = json_object_new_array();
 	json_object_array_add(nodes, workspace);
 	json_object_object_add(output, "nodes", nodes);
@@ -424,8 +464,6 @@ static void ipc_json_describe_workspace(struct sway_workspace *workspace,
 	json_object_object_add(object, "output", workspace->output ?
 			json_object_new_string(workspace->output->wlr_output->name) : NULL);
 	json_object_object_add(object, "type", json_object_new_string("workspace"));
-	json_object_object_add(object, "urgent",
-			json_object_new_boolean(workspace->urgent));
 	json_object_object_add(object, "representation", workspace->representation ?
 			json_object_new_string(workspace->representation) : NULL);
 
@@ -435,15 +473,6 @@ static void ipc_json_describe_workspace(struct sway_workspace *workspace,
 	json_object_object_add(object, "orientation",
 			json_object_new_string(
 				ipc_json_orientation_description(workspace->layout)));
-
-	// Floating
-	json_object *floating_array = json_object_new_array();
-	for (int i = 0; i < workspace->floating->length; ++i) {
-		struct sway_container *floater = workspace->floating->items[i];
-		json_object_array_add(floating_array,
-				ipc_json_describe_node_recursive(&floater->node));
-	}
-	json_object_object_add(object, "floating_nodes", floating_array);
 }
 
 static void get_deco_rect(struct sway_container *c, struct wlr_box *deco_rect) {
@@ -490,9 +519,6 @@ static void ipc_json_describe_view(struct sway_container *c, json_object *object
 	json_object_object_add(object, "app_id",
 			app_id ? json_object_new_string(app_id) : NULL);
 
-	bool visible = view_is_visible(c->view);
-	json_object_object_add(object, "visible", json_object_new_boolean(visible));
-
 	struct wlr_box window_box = {
 		c->content_x - c->x,
 		(c->current.border == B_PIXEL) ? c->current.border_thickness : 0,
@@ -505,40 +531,8 @@ static void ipc_json_describe_view(struct sway_container *c, json_object *object
 	struct wlr_box geometry = {0, 0, c->view->natural_width, c->view->natural_height};
 	json_object_object_add(object, "geometry", ipc_json_create_rect(&geometry));
 
-	json_object_object_add(object, "max_render_time", json_object_new_int(c->view->max_render_time));
-
 	json_object_object_add(object, "shell", json_object_new_string(view_get_shell(c->view)));
 
-	json_object_object_add(object, "inhibit_idle",
-		json_object_new_boolean(view_inhibit_idle(c->view)));
-
-	json_object *idle_inhibitors = json_object_new_object();
-
-	struct sway_idle_inhibitor_v1 *user_inhibitor =
-		sway_idle_inhibit_v1_user_inhibitor_for_view(c->view);
-
-	if (user_inhibitor) {
-		json_object_object_add(idle_inhibitors, "user",
-			json_object_new_string(
-				ipc_json_user_idle_inhibitor_description(user_inhibitor->mode)));
-	} else {
-		json_object_object_add(idle_inhibitors, "user",
-			json_object_new_string("none"));
-	}
-
-	struct sway_idle_inhibitor_v1 *application_inhibitor =
-		sway_idle_inhibit_v1_application_inhibitor_for_view(c->view);
-
-	if (application_inhibitor) {
-		json_object_object_add(idle_inhibitors, "application",
-			json_object_new_string("enabled"));
-	} else {
-		json_object_object_add(idle_inhibitors, "application",
-			json_object_new_string("none"));
-	}
-
-	json_object_object_add(object, "idle_inhibitors", idle_inhibitors);
-
 #if HAVE_XWAYLAND
 	if (c->view->type == SWAY_VIEW_XWAYLAND) {
 		json_object_object_add(object, "window",
@@ -580,6 +574,67 @@ static void ipc_json_describe_view(struct sway_container *c, json_object *object
 #endif
 }
 
+/**
+ * Describe the parts of a view which change without the view's node being
+ * marked dirty.
+ */
+static void ipc_json_describe_view_state(struct sway_view *view,
+		json_object *object) {
+	bool visible = view_is_visible(view);
+	json_object_object_add(object, "visible", json_object_new_boolean(visible));
+
+	// Adjusted on commits in adaptive mode
+	json_object_object_add(object, "max_render_time",
+			json_object_new_int(view->max_render_time));
+	json_object_object_add(object, "max_render_time_adaptive",
+			json_object_new_boolean(view->max_render_time_adaptive));
+
+	const struct sway_txn_client_stats *txn_stats =
+		transaction_get_client_stats(view);
+	if (txn_stats) {
+		json_object *latency = json_object_new_object();
+		json_object_object_add(latency, "average_ms",
+				json_object_new_double(txn_stats->latency_ms));
+		json_object_object_add(latency, "samples",
+				json_object_new_int(txn_stats->samples));
+		json_object_object_add(latency, "timeouts",
+				json_object_new_int(txn_stats->timeouts));
+		json_object_object_add(latency, "slow",
+				json_object_new_boolean(txn_stats->slow));
+		json_object_object_add(object, "configure_latency", latency);
+	}
+
+	json_object_object_add(object, "inhibit_idle",
+		json_object_new_boolean(view_inhibit_idle(view)));
+
+	json_object *idle_inhibitors = json_object_new_object();
+
+	struct sway_idle_inhibitor_v1 *user_inhibitor =
+		sway_idle_inhibit_v1_user_inhibitor_for_view(view);
+
+	if (user_inhibitor) {
+		json_object_object_add(idle_inhibitors, "user",
+			json_object_new_string(
+				ipc_json_user_idle_inhibitor_description(user_inhibitor->mode)));
+	} else {
+		json_object_object_add(idle_inhibitors, "user",
+			json_object_new_string("none"));
+	}
+
+	struct sway_idle_inhibitor_v1 *application_inhibitor =
+		sway_idle_inhibit_v1_application_inhibitor_for_view(view);
+
+	if (application_inhibitor) {
+		json_object_object_add(idle_inhibitors, "application",
+			json_object_new_string("enabled"));
+	} else {
+		json_object_object_add(idle_inhibitors, "application",
+			json_object_new_string("none"));
+	}
+
+	json_object_object_add(object, "idle_inhibitors", idle_inhibitors);
+}
+
 static void ipc_json_describe_container(struct sway_container *c, json_object *object) {
 	json_object_object_add(object, "name",
 			c->title ? json_object_new_string(c->title) : NULL);
@@ -594,9 +649,6 @@ static void ipc_json_describe_container(struct sway_container *c, json_object *o
 			json_object_new_string(
 				ipc_json_orientation_description(c->layout)));
 
-	bool urgent = c->view ?
-		view_is_urgent(c->view) : container_has_urgent_child(c);
-	json_object_object_add(object, "urgent", json_object_new_boolean(urgent));
 	json_object_object_add(object, "sticky", json_object_new_boolean(c->is_sticky));
 
 	json_object_object_add(object, "fullscreen_mode",
@@ -667,9 +719,11 @@ static void focus_inactive_children_iterator(struct sway_node *node,
 	json_object_array_add(focus, json_object_new_int(node->id));
 }
 
-json_object *ipc_json_describe_node(struct sway_node *node) {
-	struct sway_seat *seat = input_manager_get_default_seat();
-	bool focused = seat_get_focus(seat) == node;
+/**
+ * Describe everything about a node except for its children and the state
+ * added by ipc_json_describe_node_state.
+ */
+static json_object *ipc_json_describe_node_static(struct sway_node *node) {
 	char *name = node_get_name(node);
 
 	struct wlr_box box;
@@ -685,15 +739,8 @@ json_object *ipc_json_describe_node(struct sway_node *node) {
 		box.height -= deco_rect.height * count;
 	}
 
-	json_object *focus = json_object_new_array();
-	struct focus_inactive_data data = {
-		.node = node,
-		.object = focus,
-	};
-	seat_for_each_node(seat, focus_inactive_children_iterator, &data);
-
 	json_object *object = ipc_json_create_node(
-				(int)node->id, name, focused, focus, &box);
+				(int)node->id, name, false, NULL, &box);
 
 	switch (node->type) {
 	case N_ROOT:
@@ -713,6 +760,45 @@ json_object *ipc_json_describe_node(struct sway_node *node) {
 	return object;
 }
 
+/**
+ * Describe the focus and urgency of a node, which change without the node
+ * being marked dirty.
+ */
+static void ipc_json_describe_node_state(struct sway_node *node,
+		json_object *object) {
+	struct sway_seat *seat = input_manager_get_default_seat();
+	bool focused = seat_get_focus(seat) == node;
+	json_object_object_add(object, "focused", json_object_new_boolean(focused));
+
+	json_object *focus = json_object_new_array();
+	struct focus_inactive_data data = {
+		.node = node,
+		.object = focus,
+	};
+	seat_for_each_node(seat, focus_inactive_children_iterator, &data);
+	json_object_object_add(object, "focus", focus);
+
+	bool urgent = false;
+	if (node->type == N_WORKSPACE) {
+		urgent = node->sway_workspace->urgent;
+	} else if (node->type == N_CONTAINER) {
+		struct sway_container *c = node->sway_container;
+		urgent = c->view ?
+			view_is_urgent(c->view) : container_has_urgent_child(c);
+	}
+	json_object_object_add(object, "urgent", json_object_new_boolean(urgent));
+
+	if (node_is_view(node)) {
+		ipc_json_describe_view_state(node->sway_container->view, object);
+	}
+}
+
+json_object *ipc_json_describe_node(struct sway_node *node) {
+	json_object *object = ipc_json_describe_node_static(node);
+	ipc_json_describe_node_state(node, object);
+	return object;
+}
+
 json_object *ipc_json_describe_node_recursive(struct sway_node *node) {
 	json_object *object = ipc_json_describe_node(node);
 	int i;
@@ -741,6 +827,15 @@ json_object *ipc_json_describe_node_recursive(struct sway_node *node) {
 			json_object_array_add(children,
 					ipc_json_describe_node_recursive(&con->node));
 		}
+
+		json_object *floating = json_object_new_array();
+		for (i = 0; i < node->sway_workspace->floating->length; ++i) {
+			struct sway_container *floater =
+				node->sway_workspace->floating->items[i];
+			json_object_array_add(floating,
+					ipc_json_describe_node_recursive(&floater->node));
+		}
+		json_object_object_add(object, "floating_nodes", floating);
 		break;
 	case N_CONTAINER:
 		if (node->sway_container->children) {
@@ -758,6 +853,543 @@ json_object *ipc_json_describe_node_recursive(struct sway_node *node) {
 	return object;
 }
 
+static json_object *describe_container_ids(list_t *containers) {
+	json_object *ids = json_object_new_array();
+	for (int i = 0; i < containers->length; ++i) {
+		struct sway_container *con = containers->items[i];
+		json_object_array_add(ids, json_object_new_int(con->node.id));
+	}
+	return ids;
+}
+
+json_object *ipc_json_describe_node_flat(struct sway_node *node) {
+	json_object *object = ipc_json_describe_node_static(node);
+	// Left at their defaults by ipc_json_describe_node_static
+	json_object_object_del(object, "focused");
+	json_object_object_del(object, "focus");
+	json_object_object_del(object, "urgent");
+	// Only meaningful in get_tree, where it says which deltas are included
+	json_object_object_del(object, "generation");
+	// Change without the output being marked dirty
+	json_object_object_del(object, "max_render_time");
+	json_object_object_del(object, "max_render_time_adaptive");
+	json_object_object_del(object, "scanout");
+
+	json_object *nodes = NULL;
+	switch (node->type) {
+	case N_ROOT:
+		nodes = json_object_new_array();
+		for (int i = 0; i < root->outputs->length; ++i) {
+			struct sway_output *output = root->outputs->items[i];
+			json_object_array_add(nodes, json_object_new_int(output->node.id));
+		}
+		break;
+	case N_OUTPUT:
+		nodes = json_object_new_array();
+		for (int i = 0; i < node->sway_output->workspaces->length; ++i) {
+			struct sway_workspace *ws = node->sway_output->workspaces->items[i];
+			json_object_array_add(nodes, json_object_new_int(ws->node.id));
+		}
+		break;
+	case N_WORKSPACE:
+		nodes = describe_container_ids(node->sway_workspace->tiling);
+		json_object_object_add(object, "floating_nodes",
+				describe_container_ids(node->sway_workspace->floating));
+		break;
+	case N_CONTAINER:
+		nodes = node->sway_container->children ?
+			describe_container_ids(node->sway_container->children) :
+			json_object_new_array();
+		break;
+	}
+	json_object_object_add(object, "nodes", nodes);
+
+	return object;
+}
+
+/**
+ * Growable buffer for get_tree replies. It is kept between requests so that
+ * clients polling the tree don't cause a large allocation for every reply.
+ */
+struct json_buffer {
+	char *data;
+	size_t length;
+	size_t capacity;
+	bool failed;
+};
+
+static struct json_buffer tree_buffer;
+
+static void json_buffer_append(struct json_buffer *buffer,
+		const char *data, size_t length) {
+	if (buffer->failed) {
+		return;
+	}
+	if (buffer->length + length > buffer->capacity) {
+		size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+		while (capacity < buffer->length + length) {
+			capacity *= 2;
+		}
+		char *new_data = realloc(buffer->data, capacity);
+		if (!new_data) {
+			sway_log(SWAY_ERROR, "Unable to grow tree buffer");
+			buffer->failed = true;
+			return;
+		}
+		buffer->data = new_data;
+		buffer->capacity = capacity;
+	}
+	memcpy(buffer->data + buffer->length, data, length);
+	buffer->length += length;
+}
+
+static void json_buffer_append_str(struct json_buffer *buffer,
+		const char *str) {
+	json_buffer_append(buffer, str, strlen(str));
+}
+
+/**
+ * Append the members of a non-empty object, without the enclosing braces.
+ */
+static void json_buffer_append_members(struct json_buffer *buffer,
+		json_object *object) {
+	const char *str =
+		json_object_to_json_string_ext(object, JSON_C_TO_STRING_PLAIN);
+	json_buffer_append(buffer, str + 1, strlen(str) - 2);
+}
+
+/**
+ * Pick the requested fields of a node in the order they were asked for.
+ * Fields are looked up in the state first, if given, and then in the object.
+ * Children are never taken from the objects, since they are described
+ * separately.
+ */
+static json_object *select_fields(json_object *state, json_object *object,
+		list_t *fields) {
+	json_object *selected = json_object_new_object();
+	for (int i = 0; i < fields->length; ++i) {
+		const char *field = fields->items[i];
+		json_object *value;
+		if (strcmp(field, "nodes") == 0 ||
+				strcmp(field, "floating_nodes") == 0) {
+			continue;
+		}
+		if ((!state || !json_object_object_get_ex(state, field, &value)) &&
+				!json_object_object_get_ex(object, field, &value)) {
+			continue;
+		}
+		json_object_object_add(selected, field, json_object_get(value));
+	}
+	return selected;
+}
+
+/**
+ * Append the members of an object unless it is empty. Returns false if
+ * nothing was appended.
+ */
+static bool json_buffer_append_nonempty(struct json_buffer *buffer,
+		json_object *object) {
+	if (json_object_object_length(object) == 0) {
+		return false;
+	}
+	json_buffer_append_members(buffer, object);
+	return true;
+}
+
+/**
+ * Append the members of a node description which was built as a json-c
+ * object, applying the query's field selection. Returns false if nothing
+ * was appended.
+ */
+static bool write_object_members(struct json_buffer *buffer,
+		json_object *object, const struct ipc_tree_query *query) {
+	if (query->fields) {
+		json_object *selected = select_fields(NULL, object, query->fields);
+		bool members = json_buffer_append_nonempty(buffer, selected);
+		json_object_put(selected);
+		return members;
+	}
+	json_object_object_del(object, "nodes");
+	json_object_object_del(object, "floating_nodes");
+	json_buffer_append_members(buffer, object);
+	return true;
+}
+
+/**
+ * Describe a node for get_tree without its focus state and children.
+ */
+static json_object *describe_node_members(struct sway_node *node) {
+	json_object *object = ipc_json_describe_node_static(node);
+	json_object_object_del(object, "focused");
+	json_object_object_del(object, "focus");
+	json_object_object_del(object, "urgent");
+	json_object_object_del(object, "nodes");
+	json_object_object_del(object, "floating_nodes");
+	return object;
+}
+
+static bool node_ipc_json_cacheable(struct sway_node *node) {
+	return node->type == N_WORKSPACE || node->type == N_CONTAINER;
+}
+
+/**
+ * Describe a node for get_tree without its children, applying the query's
+ * field selection. The static part of the description is kept on workspaces
+ * and containers as an object until they change, and shared with the result.
+ */
+static json_object *describe_node_with_state(struct sway_node *node,
+		const struct ipc_tree_query *query) {
+	bool cacheable = node_ipc_json_cacheable(node);
+	json_object *object = cacheable ? node->ipc_json_object : NULL;
+	if (!object) {
+		object = describe_node_members(node);
+		if (cacheable) {
+			node->ipc_json_object = object;
+		}
+	}
+	json_object *state = json_object_new_object();
+	ipc_json_describe_node_state(node, state);
+
+	json_object *result;
+	if (query->fields) {
+		result = select_fields(state, object, query->fields);
+	} else {
+		result = json_object_new_object();
+		json_object_object_foreach(object, key, value) {
+			json_object_object_add(result, key, json_object_get(value));
+		}
+		json_object_object_foreach(state, state_key, state_value) {
+			json_object_object_add(result, state_key,
+					json_object_get(state_value));
+		}
+	}
+
+	json_object_put(state);
+	if (!cacheable) {
+		json_object_put(object);
+	}
+	return result;
+}
+
+/**
+ * Open the object describing a node, leaving it ready for its children.
+ * Returns false if the object has no members yet.
+ *
+ * The description of workspaces and containers is kept on the node until it
+ * changes, so only the focus and urgency state has to be worked out again.
+ * Queries selecting fields keep it as an object to pick the fields from, and
+ * others as serialized members. Outputs aren't cached since their scanout
+ * statistics change every frame.
+ */
+static bool write_node_open(struct json_buffer *buffer,
+		struct sway_node *node, const struct ipc_tree_query *query) {
+	json_buffer_append_str(buffer, "{");
+	if (query->fields) {
+		json_object *object = describe_node_with_state(node, query);
+		bool members = json_buffer_append_nonempty(buffer, object);
+		json_object_put(object);
+		return members;
+	}
+
+	bool cacheable = node_ipc_json_cacheable(node);
+	if (cacheable && node->ipc_json) {
+		json_buffer_append(buffer, node->ipc_json, node->ipc_json_len);
+	} else {
+		json_object *object = describe_node_members(node);
+		const char *str =
+			json_object_to_json_string_ext(object, JSON_C_TO_STRING_PLAIN);
+		size_t length = strlen(str) - 2;
+		json_buffer_append(buffer, str + 1, length);
+		if (cacheable) {
+			node->ipc_json = strndup(str + 1, length);
+			node->ipc_json_len = node->ipc_json ? length : 0;
+		}
+		json_object_put(object);
+	}
+
+	json_object *state = json_object_new_object();
+	ipc_json_describe_node_state(node, state);
+	json_buffer_append_str(buffer, ",");
+	json_buffer_append_members(buffer, state);
+	json_object_put(state);
+	return true;
+}
+
+/**
+ * Start the array of children with the given key.
+ */
+static void write_children_open(struct json_buffer *buffer, const char *key,
+		bool *members) {
+	if (*members) {
+		json_buffer_append_str(buffer, ",");
+	}
+	json_buffer_append_str(buffer, "\"");
+	json_buffer_append_str(buffer, key);
+	json_buffer_append_str(buffer, "\":[");
+	*members = true;
+}
+
+static int child_depth(int depth) {
+	return depth < 0 ? depth : depth - 1;
+}
+
+static void write_node_recursive(struct json_buffer *buffer,
+		struct sway_node *node, const struct ipc_tree_query *query, int depth);
+
+static void write_container_list(struct json_buffer *buffer,
+		list_t *containers, const struct ipc_tree_query *query, int depth) {
+	for (int i = 0; i < containers->length; ++i) {
+		struct sway_container *con = containers->items[i];
+		if (i > 0) {
+			json_buffer_append_str(buffer, ",");
+		}
+		write_node_recursive(buffer, &con->node, query, depth);
+	}
+}
+
+static void write_scratchpad_output(struct json_buffer *buffer,
+		const struct ipc_tree_query *query, int depth) {
+	json_object *output = ipc_json_create_scratchpad_output();
+	json_buffer_append_str(buffer, "{");
+	bool members = write_object_members(buffer, output, query);
+	json_object_put(output);
+
+	if (depth != 0) {
+		write_children_open(buffer, "nodes", &members);
+		json_object *workspace = ipc_json_create_scratchpad_workspace();
+		json_buffer_append_str(buffer, "{");
+		bool workspace_members = write_object_members(buffer, workspace, query);
+		json_object_put(workspace);
+
+		if (child_depth(depth) != 0) {
+			// The workspace has no tiling children, but i3 clients expect
+			// the array to be there
+			write_children_open(buffer, "nodes", &workspace_members);
+			json_buffer_append_str(buffer, "]");
+
+			// List all hidden scratchpad containers as floating nodes
+			write_children_open(buffer, "floating_nodes", &workspace_members);
+			bool first = true;
+			for (int i = 0; i < root->scratchpad->length; ++i) {
+				struct sway_container *container = root->scratchpad->items[i];
+				if (container_is_scratchpad_hidden(container)) {
+					if (!first) {
+						json_buffer_append_str(buffer, ",");
+					}
+					write_node_recursive(buffer, &container->node, query,
+							child_depth(child_depth(depth)));
+					first = false;
+				}
+			}
+			json_buffer_append_str(buffer, "]");
+		}
+		json_buffer_append_str(buffer, "}]");
+	}
+	json_buffer_append_str(buffer, "}");
+}
+
+/**
+ * Write a node and its children down to the given depth, where a negative
+ * depth means no limit. Nodes at the depth limit are written without their
+ * nodes and floating_nodes arrays.
+ */
+static void write_node_recursive(struct json_buffer *buffer,
+		struct sway_node *node, const struct ipc_tree_query *query, int depth) {
+	bool members = write_node_open(buffer, node, query);
+	if (depth == 0) {
+		json_buffer_append_str(buffer, "}");
+		return;
+	}
+	depth = child_depth(depth);
+
+	write_children_open(buffer, "nodes", &members);
+	switch (node->type) {
+	case N_ROOT:
+		write_scratchpad_output(buffer, query, depth);
+		for (int i = 0; i < root->outputs->length; ++i) {
+			struct sway_output *output = root->outputs->items[i];
+			json_buffer_append_str(buffer, ",");
+			write_node_recursive(buffer, &output->node, query, depth);
+		}
+		break;
+	case N_OUTPUT:
+		for (int i = 0; i < node->sway_output->workspaces->length; ++i) {
+			struct sway_workspace *ws = node->sway_output->workspaces->items[i];
+			if (i > 0) {
+				json_buffer_append_str(buffer, ",");
+			}
+			write_node_recursive(buffer, &ws->node, query, depth);
+		}
+		break;
+	case N_WORKSPACE:
+		write_container_list(buffer, node->sway_workspace->tiling, query, depth);
+		break;
+	case N_CONTAINER:
+		if (node->sway_container->children) {
+			write_container_list(buffer, node->sway_container->children,
+					query, depth);
+		}
+		break;
+	}
+	json_buffer_append_str(buffer, "]");
+
+	write_children_open(buffer, "floating_nodes", &members);
+	if (node->type == N_WORKSPACE) {
+		write_container_list(buffer, node->sway_workspace->floating,
+				query, depth);
+	}
+	json_buffer_append_str(buffer, "]}");
+}
+
+const char *ipc_json_serialize_tree(const struct ipc_tree_query *query,
+		size_t *length) {
+	tree_buffer.length = 0;
+	tree_buffer.failed = false;
+	if (query->nodes) {
+		json_buffer_append_str(&tree_buffer, "[");
+		for (int i = 0; i < query->nodes->length; ++i) {
+			if (i > 0) {
+				json_buffer_append_str(&tree_buffer, ",");
+			}
+			write_node_recursive(&tree_buffer, query->nodes->items[i],
+					query, query->depth);
+		}
+		json_buffer_append_str(&tree_buffer, "]");
+	} else {
+		write_node_recursive(&tree_buffer, &root->node, query, query->depth);
+	}
+	json_buffer_append(&tree_buffer, "", 1);
+	if (tree_buffer.failed) {
+		return NULL;
+	}
+	*length = tree_buffer.length - 1;
+	return tree_buffer.data;
+}
+
+static json_object *describe_node_tree(struct sway_node *node,
+		const struct ipc_tree_query *query, int depth);
+
+static json_object *describe_container_list(list_t *containers,
+		const struct ipc_tree_query *query, int depth) {
+	json_object *array = json_object_new_array();
+	for (int i = 0; i < containers->length; ++i) {
+		struct sway_container *con = containers->items[i];
+		json_object_array_add(array, describe_node_tree(&con->node, query,
+					depth));
+	}
+	return array;
+}
+
+/**
+ * Apply the query's field selection to a node description which was built
+ * as a json-c object, consuming it.
+ */
+static json_object *select_object_members(json_object *object,
+		const struct ipc_tree_query *query) {
+	json_object_object_del(object, "nodes");
+	json_object_object_del(object, "floating_nodes");
+	if (!query->fields) {
+		return object;
+	}
+	json_object *selected = select_fields(NULL, object, query->fields);
+	json_object_put(object);
+	return selected;
+}
+
+static json_object *describe_scratchpad_output_tree(
+		const struct ipc_tree_query *query, int depth) {
+	json_object *output = select_object_members(
+			ipc_json_create_scratchpad_output(), query);
+	if (depth == 0) {
+		return output;
+	}
+
+	json_object *workspace = select_object_members(
+			ipc_json_create_scratchpad_workspace(), query);
+	if (child_depth(depth) != 0) {
+		json_object_object_add(workspace, "nodes", json_object_new_array());
+		json_object *floating = json_object_new_array();
+		for (int i = 0; i < root->scratchpad->length; ++i) {
+			struct sway_container *container = root->scratchpad->items[i];
+			if (container_is_scratchpad_hidden(container)) {
+				json_object_array_add(floating,
+					describe_node_tree(&container->node, query,
+						child_depth(child_depth(depth))));
+			}
+		}
+		json_object_object_add(workspace, "floating_nodes", floating);
+	}
+	json_object *nodes = json_object_new_array();
+	json_object_array_add(nodes, workspace);
+	json_object_object_add(output, "nodes", nodes);
+	return output;
+}
+
+/**
+ * Describe a node and its children like write_node_recursive, but as a
+ * json-c object.
+ */
+static json_object *describe_node_tree(struct sway_node *node,
+		const struct ipc_tree_query *query, int depth) {
+	json_object *object = describe_node_with_state(node, query);
+	if (depth == 0) {
+		return object;
+	}
+	depth = child_depth(depth);
+
+	json_object *nodes = NULL;
+	json_object *floating = NULL;
+	switch (node->type) {
+	case N_ROOT:
+		nodes = json_object_new_array();
+		json_object_array_add(nodes,
+				describe_scratchpad_output_tree(query, depth));
+		for (int i = 0; i < root->outputs->length; ++i) {
+			struct sway_output *output = root->outputs->items[i];
+			json_object_array_add(nodes,
+					describe_node_tree(&output->node, query, depth));
+		}
+		break;
+	case N_OUTPUT:
+		nodes = json_object_new_array();
+		for (int i = 0; i < node->sway_output->workspaces->length; ++i) {
+			struct sway_workspace *ws = node->sway_output->workspaces->items[i];
+			json_object_array_add(nodes,
+					describe_node_tree(&ws->node, query, depth));
+		}
+		break;
+	case N_WORKSPACE:
+		nodes = describe_container_list(node->sway_workspace->tiling,
+				query, depth);
+		floating = describe_container_list(node->sway_workspace->floating,
+				query, depth);
+		break;
+	case N_CONTAINER:
+		nodes = node->sway_container->children ?
+			describe_container_list(node->sway_container->children,
+					query, depth) :
+			json_object_new_array();
+		break;
+	}
+	json_object_object_add(object, "nodes", nodes);
+	json_object_object_add(object, "floating_nodes",
+			floating ? floating : json_object_new_array());
+	return object;
+}
+
+json_object *ipc_json_describe_tree(const struct ipc_tree_query *query) {
+	if (!query->nodes) {
+		return describe_node_tree(&root->node, query, query->depth);
+	}
+	json_object *array = json_object_new_array();
+	for (int i = 0; i < query->nodes->length; ++i) {
+		json_object_array_add(array,
+				describe_node_tree(query->nodes->items[i], query,
+					query->depth));
+	}
+	return array;
+}
+
 static json_object *describe_libinput_device(struct libinput_device *device) {
 	json_object *object = json_object_new_object();
 
@@ -1006,6 +1638,125 @@ json_object *ipc_json_describe_input(struct sway_input_device *device) {
 	return object;
 }
 
+static json_object *describe_render_histogram(
+		struct render_histogram *hist) {
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "count",
+		json_object_new_int64(hist->count));
+	json_object_object_add(object, "average_usec", json_object_new_int64(
+		hist->count ? hist->total_usec / hist->count : 0));
+	json_object_object_add(object, "max_usec",
+		json_object_new_int64(hist->max_usec));
+	json_object *buckets = json_object_new_array();
+	for (int i = 0; i < RENDER_HISTOGRAM_BUCKETS; ++i) {
+		json_object_array_add(buckets,
+			json_object_new_int64(hist->buckets[i]));
+	}
+	json_object_object_add(object, "buckets", buckets);
+	return object;
+}
+
+json_object *ipc_json_describe_render_stats(struct sway_output *output) {
+	struct render_stats *stats = &output->render_stats;
+	json_object *object = json_object_new_object();
+
+	json_object_object_add(object, "name",
+		json_object_new_string(output->wlr_output->name));
+	json_object_object_add(object, "refresh_nsec",
+		json_object_new_int64(output->refresh_nsec));
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	int64_t msec = (now.tv_sec - stats->reset_time.tv_sec) * 1000 +
+		(now.tv_nsec - stats->reset_time.tv_nsec) / 1000000;
+	json_object_object_add(object, "msec_since_reset",
+		json_object_new_int64(msec));
+
+	json_object_object_add(object, "frames",
+		describe_render_histogram(&stats->total));
+	json_object *phases = json_object_new_object();
+	for (int i = 0; i < RENDER_PHASE_COUNT; ++i) {
+		json_object_object_add(phases, render_phase_to_str(i),
+			describe_render_histogram(&stats->phases[i]));
+	}
+	json_object_object_add(object, "phases", phases);
+	json_object_object_add(object, "slack",
+		describe_render_histogram(&stats->slack));
+	json_object_object_add(object, "missed_vblanks",
+		json_object_new_int64(stats->missed_vblanks));
+
+	return object;
+}
+
+static void describe_transaction_trace_event(
+		const struct transaction_trace_event *event, void *data) {
+	json_object *events = data;
+	json_object *object = json_object_new_object();
+
+	int64_t usec = (int64_t)event->time.tv_sec * 1000000 +
+		event->time.tv_nsec / 1000;
+	json_object_object_add(object, "cat",
+		json_object_new_string("transaction"));
+	json_object_object_add(object, "ts", json_object_new_int64(usec));
+	json_object_object_add(object, "pid", json_object_new_int(getpid()));
+	// Events about a single node go on the node's own track
+	json_object_object_add(object, "tid",
+		json_object_new_int64(event->node_id));
+
+	switch (event->type) {
+	case TXN_TRACE_COMMIT:
+	case TXN_TRACE_APPLY:
+		// Async span from commit to apply
+		json_object_object_add(object, "name",
+			json_object_new_string("transaction"));
+		json_object_object_add(object, "ph", json_object_new_string(
+			event->type == TXN_TRACE_COMMIT ? "b" : "e"));
+		json_object_object_add(object, "id",
+			json_object_new_int64(event->transaction));
+		break;
+	default:
+		json_object_object_add(object, "name", json_object_new_string(
+			transaction_trace_type_to_str(event->type)));
+		json_object_object_add(object, "ph", json_object_new_string("i"));
+		json_object_object_add(object, "s", json_object_new_string("t"));
+		break;
+	}
+
+	json_object *args = json_object_new_object();
+	if (event->transaction) {
+		json_object_object_add(args, "transaction",
+			json_object_new_int64(event->transaction));
+	}
+	if (event->node_id) {
+		json_object_object_add(args, "node",
+			json_object_new_int64(event->node_id));
+	}
+	if (event->type == TXN_TRACE_CONFIGURE) {
+		json_object_object_add(args, "width",
+			json_object_new_int(event->width));
+		json_object_object_add(args, "height",
+			json_object_new_int(event->height));
+	}
+	if (event->serial) {
+		json_object_object_add(args, "serial",
+			json_object_new_int64(event->serial));
+	}
+	json_object_object_add(object, "args", args);
+
+	json_object_array_add(events, object);
+}
+
+json_object *ipc_json_describe_transaction_trace(void) {
+	json_object *events = json_object_new_array();
+	transaction_trace_for_each(describe_transaction_trace_event, events);
+
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "traceEvents", events);
+	json_object_object_add(object, "displayTimeUnit",
+		json_object_new_string("ms"));
+	return object;
+}
+
 json_object *ipc_json_describe_seat(struct sway_seat *seat) {
 	if (!(sway_assert(seat, "Seat must not be null"))) {
 		return NULL;
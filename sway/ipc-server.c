@@ -1,5 +1,5 @@
 // See https://i3wm.org/docs/ipc.html for protocol information
-#define _POSIX_C_SOURCE 200112L
+#define _POSIX_C_SOURCE 200809L
 #include <linux/input-event-codes.h>
 #include <assert.h>
 #include <errno.h>
@@ -12,11 +12,13 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 #include <wayland-server-core.h>
 #include "sway/commands.h"
 #include "sway/config.h"
+#include "sway/criteria.h"
 #include "sway/desktop/transaction.h"
 #include "sway/ipc-json.h"
 #include "sway/ipc-server.h"
@@ -28,6 +30,7 @@
 #include "sway/tree/root.h"
 #include "sway/tree/view.h"
 #include "sway/tree/workspace.h"
+#include "cbor.h"
 #include "list.h"
 #include "log.h"
 #include "util.h"
@@ -38,19 +41,74 @@ static struct sockaddr_un *ipc_sockaddr = NULL;
 static list_t *ipc_client_list = NULL;
 static struct wl_listener ipc_display_destroy;
 
+// Number of clients subscribed to each event type, indexed by the low bits
+// of the event type like event_mask
+#define IPC_EVENT_TYPES 32
+#define ipc_event_index(ev) ((ev) & (IPC_EVENT_TYPES - 1))
+static int ipc_event_listeners[IPC_EVENT_TYPES];
+
+// Nodes changed since the last tree_delta event
+static list_t *tree_delta_nodes = NULL;
+static struct wl_event_source *tree_delta_idle = NULL;
+// The last described state of each node is only valid for the epoch it was
+// described in. A new epoch starts whenever tree_delta gains its first
+// subscriber, since nodes weren't tracked while nobody was listening.
+static uint32_t tree_delta_epoch = 1;
+static size_t tree_delta_focused = 0;
+
 static const char ipc_magic[] = {'i', '3', '-', 'i', 'p', 'c'};
 
 #define IPC_HEADER_SIZE (sizeof(ipc_magic) + 8)
 
+// Clients which let this much data pile up are disconnected, or miss events
+// if they subscribed with coalescing
+#define IPC_MAX_QUEUED_BYTES (4 * 1024 * 1024)
+// Coalescing clients which missed events get them again once their queue has
+// drained below this
+#define IPC_RESUME_QUEUED_BYTES (IPC_MAX_QUEUED_BYTES / 2)
+// Maximum number of payloads passed to a single writev call
+#define IPC_WRITEV_MAX 64
+
+/**
+ * A message ready to be sent, header included. Events are queued for every
+ * subscribed client, so payloads are reference counted and shared between
+ * the clients' write queues rather than copied into each of them.
+ */
+struct ipc_payload {
+	size_t refcount;
+	enum ipc_command_type type;
+	// Events about the same node with the same change supersede each other
+	// in the queues of coalescing clients. A node_id of 0 never coalesces.
+	size_t node_id;
+	char *change;
+	size_t size;
+	char data[]; // Header followed by the payload
+};
+
+/**
+ * Encoding of the replies and events sent to a client, chosen by the client
+ * with IPC_SET_ENCODING. Requests are always JSON.
+ */
+enum ipc_encoding {
+	IPC_ENCODING_JSON,
+	IPC_ENCODING_CBOR,
+	IPC_ENCODING_COUNT,
+};
+
 struct ipc_client {
 	struct wl_event_source *event_source;
 	struct wl_event_source *writable_event_source;
 	struct sway_server *server;
 	int fd;
 	enum ipc_command_type subscribed_events;
-	size_t write_buffer_len;
-	size_t write_buffer_size;
-	char *write_buffer;
+	enum ipc_encoding encoding;
+	list_t *write_queue; // struct ipc_payload *
+	size_t write_offset; // Bytes of the first payload which have been sent
+	size_t write_queued; // Bytes left to send
+	// Replace queued events with newer ones, and drop events instead of
+	// disconnecting when the queue is full
+	bool coalesce;
+	size_t events_dropped; // Since the queue filled up
 	// The following are for storing data between event_loop calls
 	uint32_t pending_length;
 	enum ipc_command_type pending_type;
@@ -65,6 +123,154 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	enum ipc_command_type payload_type);
 bool ipc_send_reply(struct ipc_client *client, enum ipc_command_type payload_type,
 	const char *payload, uint32_t payload_length);
+bool ipc_send_reply_json(struct ipc_client *client,
+	enum ipc_command_type payload_type, json_object *obj);
+
+static struct ipc_payload *ipc_payload_create(
+		enum ipc_command_type payload_type,
+		const char *payload, uint32_t payload_length) {
+	struct ipc_payload *p =
+		malloc(sizeof(struct ipc_payload) + IPC_HEADER_SIZE + payload_length);
+	if (!p) {
+		sway_log(SWAY_ERROR, "Unable to allocate IPC payload");
+		return NULL;
+	}
+	p->refcount = 1;
+	p->type = payload_type;
+	p->node_id = 0;
+	p->change = NULL;
+	p->size = IPC_HEADER_SIZE + payload_length;
+
+	memcpy(p->data, ipc_magic, sizeof(ipc_magic));
+	memcpy(p->data + sizeof(ipc_magic), &payload_length,
+		sizeof(payload_length));
+	memcpy(p->data + sizeof(ipc_magic) + sizeof(payload_length),
+		&payload_type, sizeof(payload_type));
+	memcpy(p->data + IPC_HEADER_SIZE, payload, payload_length);
+	return p;
+}
+
+/**
+ * Create a payload holding the given JSON value in the given encoding.
+ */
+static struct ipc_payload *ipc_payload_create_json(
+		enum ipc_command_type payload_type, json_object *obj,
+		enum ipc_encoding encoding) {
+	if (encoding == IPC_ENCODING_CBOR) {
+		size_t length;
+		uint8_t *data = cbor_encode_json(obj, &length);
+		if (!data) {
+			sway_log(SWAY_ERROR, "Unable to encode IPC payload");
+			return NULL;
+		}
+		struct ipc_payload *p = ipc_payload_create(payload_type,
+			(const char *)data, (uint32_t)length);
+		free(data);
+		return p;
+	}
+	const char *json_string = json_object_to_json_string(obj);
+	return ipc_payload_create(payload_type, json_string,
+		(uint32_t)strlen(json_string));
+}
+
+static void ipc_payload_unref(struct ipc_payload *p) {
+	if (p && --p->refcount == 0) {
+		free(p->change);
+		free(p);
+	}
+}
+
+/**
+ * Add a payload to the client's write queue. On failure the client is
+ * disconnected and false is returned.
+ */
+static bool ipc_client_queue_payload(struct ipc_client *client,
+		struct ipc_payload *p) {
+	if (client->write_queued + p->size > IPC_MAX_QUEUED_BYTES) {
+		sway_log(SWAY_ERROR, "Client write queue too big (%zu), "
+				"disconnecting client", client->write_queued + p->size);
+		ipc_client_disconnect(client);
+		return false;
+	}
+
+	p->refcount++;
+	list_add(client->write_queue, p);
+	client->write_queued += p->size;
+
+	if (!client->writable_event_source) {
+		client->writable_event_source = wl_event_loop_add_fd(
+				server.wl_event_loop, client->fd, WL_EVENT_WRITABLE,
+				ipc_client_handle_writable, client);
+	}
+	return true;
+}
+
+/**
+ * Remove a queued event which the given event supersedes, if any.
+ */
+static void ipc_client_coalesce(struct ipc_client *client,
+		struct ipc_payload *p) {
+	if (p->node_id == 0) {
+		return;
+	}
+	// The first payload can't be replaced once it's been partially sent
+	int first = client->write_offset > 0 ? 1 : 0;
+	for (int i = first; i < client->write_queue->length; ++i) {
+		struct ipc_payload *queued = client->write_queue->items[i];
+		if (queued->node_id == p->node_id && queued->type == p->type &&
+				strcmp(queued->change, p->change) == 0) {
+			client->write_queued -= queued->size;
+			list_del(client->write_queue, i);
+			ipc_payload_unref(queued);
+			return;
+		}
+	}
+}
+
+/**
+ * Add an event to the client's write queue. Clients which subscribed with
+ * coalescing only get the latest of several pending events about the same
+ * node, and miss events rather than being disconnected while their queue is
+ * full. Otherwise, this behaves like ipc_client_queue_payload.
+ */
+static bool ipc_client_queue_event(struct ipc_client *client,
+		struct ipc_payload *p) {
+	if (!client->coalesce) {
+		return ipc_client_queue_payload(client, p);
+	}
+	if (client->events_dropped == 0) {
+		ipc_client_coalesce(client, p);
+		if (client->write_queued + p->size <= IPC_MAX_QUEUED_BYTES) {
+			return ipc_client_queue_payload(client, p);
+		}
+		sway_log(SWAY_INFO, "Client %d write queue too big (%zu), "
+				"dropping events", client->fd, client->write_queued + p->size);
+	}
+	client->events_dropped++;
+	return true;
+}
+
+/**
+ * Tell a coalescing client which missed events how many there were, once it
+ * has caught up with the rest of its queue.
+ */
+static void ipc_client_send_overflow(struct ipc_client *client) {
+	json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "change", json_object_new_string("overflow"));
+	json_object_object_add(obj, "dropped",
+			json_object_new_int64((int64_t)client->events_dropped));
+	struct ipc_payload *p = ipc_payload_create_json(IPC_EVENT_BACKPRESSURE,
+			obj, client->encoding);
+	json_object_put(obj);
+	if (!p) {
+		return;
+	}
+	sway_log(SWAY_INFO, "Client %d caught up, %zu events were dropped",
+			client->fd, client->events_dropped);
+	client->events_dropped = 0;
+	ipc_client_queue_payload(client, p);
+	ipc_payload_unref(p);
+}
 
 static void handle_display_destroy(struct wl_listener *listener, void *data) {
 	if (ipc_event_source) {
@@ -117,6 +323,7 @@ void ipc_init(struct sway_server *server) {
 	setenv("SWAYSOCK", ipc_sockaddr->sun_path, 1);
 
 	ipc_client_list = create_list();
+	tree_delta_nodes = create_list();
 
 	ipc_display_destroy.notify = handle_display_destroy;
 	wl_display_add_destroy_listener(server->wl_display, &ipc_display_destroy);
@@ -183,15 +390,18 @@ int ipc_handle_connection(int fd, uint32_t mask, void *data) {
 	client->pending_length = 0;
 	client->fd = client_fd;
 	client->subscribed_events = 0;
+	client->encoding = IPC_ENCODING_JSON;
+	client->coalesce = false;
+	client->events_dropped = 0;
 	client->event_source = wl_event_loop_add_fd(server->wl_event_loop,
 			client_fd, WL_EVENT_READABLE, ipc_client_handle_readable, client);
 	client->writable_event_source = NULL;
 
-	client->write_buffer_size = 128;
-	client->write_buffer_len = 0;
-	client->write_buffer = malloc(client->write_buffer_size);
-	if (!client->write_buffer) {
-		sway_log(SWAY_ERROR, "Unable to allocate ipc client write buffer");
+	client->write_offset = 0;
+	client->write_queued = 0;
+	client->write_queue = create_list();
+	if (!client->write_queue) {
+		sway_log(SWAY_ERROR, "Unable to allocate ipc client write queue");
 		close(client_fd);
 		return 0;
 	}
@@ -271,35 +481,164 @@ int ipc_client_handle_readable(int client_fd, uint32_t mask, void *data) {
 }
 
 static bool ipc_has_event_listeners(enum ipc_command_type event) {
-	for (int i = 0; i < ipc_client_list->length; i++) {
-		struct ipc_client *client = ipc_client_list->items[i];
-		if ((client->subscribed_events & event_mask(event)) != 0) {
-			return true;
+	return ipc_event_listeners[ipc_event_index(event)] > 0;
+}
+
+static void ipc_client_subscribe(struct ipc_client *client,
+		enum ipc_command_type event) {
+	if ((client->subscribed_events & event_mask(event)) == 0) {
+		client->subscribed_events |= event_mask(event);
+		if (event == IPC_EVENT_TREE_DELTA &&
+				!ipc_has_event_listeners(IPC_EVENT_TREE_DELTA)) {
+			// Changes weren't tracked while nobody was listening, so forget
+			// what was last sent. Later subscribers start from get_tree.
+			tree_delta_epoch++;
+			tree_delta_focused = 0;
+		}
+		ipc_event_listeners[ipc_event_index(event)]++;
+	}
+}
+
+void ipc_tree_delta_add(struct sway_node *node) {
+	if (node->ipc_delta_pending ||
+			!ipc_has_event_listeners(IPC_EVENT_TREE_DELTA)) {
+		return;
+	}
+	node->ipc_delta_pending = true;
+	list_add(tree_delta_nodes, node);
+}
+
+void ipc_tree_delta_forget(struct sway_node *node) {
+	if (node->ipc_delta_pending) {
+		int index = list_find(tree_delta_nodes, node);
+		if (index != -1) {
+			list_del(tree_delta_nodes, index);
 		}
+		node->ipc_delta_pending = false;
+	}
+	json_object_put(node->ipc_delta_state);
+	node->ipc_delta_state = NULL;
+}
+
+static void handle_tree_delta_idle(void *data) {
+	tree_delta_idle = NULL;
+	ipc_event_tree_delta();
+}
+
+/**
+ * Record a change which doesn't go through a transaction, such as a new
+ * title, and send it once the event loop is idle unless a transaction is
+ * applied first.
+ */
+static void ipc_tree_delta_schedule(struct sway_node *node) {
+	ipc_tree_delta_add(node);
+	if (node->ipc_delta_pending && !tree_delta_idle) {
+		tree_delta_idle = wl_event_loop_add_idle(server.wl_event_loop,
+				handle_tree_delta_idle, NULL);
 	}
-	return false;
 }
 
-static void ipc_send_event(const char *json_string, enum ipc_command_type event) {
+/**
+ * Describe the fields of a node which changed since it was last described,
+ * along with its ID. Returns NULL if nothing changed.
+ */
+static json_object *ipc_tree_delta_describe(struct sway_node *node) {
+	json_object *state = ipc_json_describe_node_flat(node);
+	json_object *old_state = node->ipc_delta_epoch == tree_delta_epoch ?
+		node->ipc_delta_state : NULL;
+
+	json_object *changes = json_object_new_object();
+	json_object_object_add(changes, "id", json_object_new_int(node->id));
+	json_object_object_foreach(state, key, value) {
+		json_object *old_value;
+		if (strcmp(key, "id") == 0) {
+			continue;
+		}
+		if (!old_state ||
+				!json_object_object_get_ex(old_state, key, &old_value) ||
+				!json_object_equal(old_value, value)) {
+			json_object_object_add(changes, key, json_object_get(value));
+		}
+	}
+	if (old_state) {
+		// Fields which are gone, such as the percent of a floating container
+		json_object_object_foreach(old_state, old_key, unused) {
+			(void)unused;
+			if (!json_object_object_get_ex(state, old_key, NULL)) {
+				json_object_object_add(changes, old_key, NULL);
+			}
+		}
+	}
+
+	json_object_put(node->ipc_delta_state);
+	node->ipc_delta_state = state;
+	node->ipc_delta_epoch = tree_delta_epoch;
+
+	if (json_object_object_length(changes) == 1) {
+		json_object_put(changes);
+		return NULL;
+	}
+	return changes;
+}
+
+/**
+ * Send an event about the given node to all subscribers. The node and change
+ * identify the events which supersede each other for coalescing clients.
+ */
+static void ipc_send_node_event(json_object *obj, enum ipc_command_type event,
+		struct sway_node *node, const char *change) {
+	// Encoded at most once per encoding, then shared by the write queues of
+	// all subscribers
+	struct ipc_payload *payloads[IPC_ENCODING_COUNT] = {0};
 	struct ipc_client *client;
 	for (int i = 0; i < ipc_client_list->length; i++) {
 		client = ipc_client_list->items[i];
 		if ((client->subscribed_events & event_mask(event)) == 0) {
 			continue;
 		}
-		if (!ipc_send_reply(client, event, json_string,
-				(uint32_t)strlen(json_string))) {
+		struct ipc_payload **payload = &payloads[client->encoding];
+		if (!*payload) {
+			*payload = ipc_payload_create_json(event, obj, client->encoding);
+			if (!*payload) {
+				continue;
+			}
+			if (node && change) {
+				(*payload)->node_id = node->id;
+				(*payload)->change = strdup(change);
+				if (!(*payload)->change) {
+					(*payload)->node_id = 0;
+				}
+			}
+		}
+		if (!ipc_client_queue_event(client, *payload)) {
 			sway_log_errno(SWAY_INFO, "Unable to send reply to IPC client");
-			/* ipc_send_reply destroys client on error, which also
-			 * removes it from the list, so we need to process
+			/* ipc_client_queue_event destroys client on error, which
+			 * also removes it from the list, so we need to process
 			 * current index again */
 			i--;
 		}
 	}
+	for (size_t i = 0; i < IPC_ENCODING_COUNT; ++i) {
+		ipc_payload_unref(payloads[i]);
+	}
+}
+
+static void ipc_send_event(json_object *obj, enum ipc_command_type event) {
+	ipc_send_node_event(obj, event, NULL, NULL);
 }
 
 void ipc_event_workspace(struct sway_workspace *old,
 		struct sway_workspace *new, const char *change) {
+	// Workspace events are emitted for changes such as renames and urgency
+	// which don't dirty the workspace, so drop the cached descriptions
+	if (old) {
+		node_invalidate_ipc_json(&old->node);
+		ipc_tree_delta_schedule(&old->node);
+	}
+	if (new) {
+		node_invalidate_ipc_json(&new->node);
+		ipc_tree_delta_schedule(&new->node);
+	}
 	if (!ipc_has_event_listeners(IPC_EVENT_WORKSPACE)) {
 		return;
 	}
@@ -320,12 +659,15 @@ void ipc_event_workspace(struct sway_workspace *old,
 		json_object_object_add(obj, "current", NULL);
 	}
 
-	const char *json_string = json_object_to_json_string(obj);
-	ipc_send_event(json_string, IPC_EVENT_WORKSPACE);
+	ipc_send_node_event(obj, IPC_EVENT_WORKSPACE,
+			new ? &new->node : NULL, change);
 	json_object_put(obj);
 }
 
 void ipc_event_window(struct sway_container *window, const char *change) {
+	// Likewise for titles, marks and the like
+	node_invalidate_ipc_json(&window->node);
+	ipc_tree_delta_schedule(&window->node);
 	if (!ipc_has_event_listeners(IPC_EVENT_WINDOW)) {
 		return;
 	}
@@ -335,8 +677,7 @@ void ipc_event_window(struct sway_container *window, const char *change) {
 	json_object_object_add(obj, "container",
 			ipc_json_describe_node_recursive(&window->node));
 
-	const char *json_string = json_object_to_json_string(obj);
-	ipc_send_event(json_string, IPC_EVENT_WINDOW);
+	ipc_send_node_event(obj, IPC_EVENT_WINDOW, &window->node, change);
 	json_object_put(obj);
 }
 
@@ -347,8 +688,7 @@ void ipc_event_barconfig_update(struct bar_config *bar) {
 	sway_log(SWAY_DEBUG, "Sending barconfig_update event");
 	json_object *json = ipc_json_describe_bar_config(bar);
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_BARCONFIG_UPDATE);
+	ipc_send_event(json, IPC_EVENT_BARCONFIG_UPDATE);
 	json_object_put(json);
 }
 
@@ -363,8 +703,7 @@ void ipc_event_bar_state_update(struct bar_config *bar) {
 	json_object_object_add(json, "visible_by_modifier",
 			json_object_new_boolean(bar->visible_by_modifier));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_BAR_STATE_UPDATE);
+	ipc_send_event(json, IPC_EVENT_BAR_STATE_UPDATE);
 	json_object_put(json);
 }
 
@@ -378,8 +717,7 @@ void ipc_event_mode(const char *mode, bool pango) {
 	json_object_object_add(obj, "pango_markup",
 			json_object_new_boolean(pango));
 
-	const char *json_string = json_object_to_json_string(obj);
-	ipc_send_event(json_string, IPC_EVENT_MODE);
+	ipc_send_event(obj, IPC_EVENT_MODE);
 	json_object_put(obj);
 }
 
@@ -392,8 +730,7 @@ void ipc_event_shutdown(const char *reason) {
 	json_object *json = json_object_new_object();
 	json_object_object_add(json, "change", json_object_new_string(reason));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_SHUTDOWN);
+	ipc_send_event(json, IPC_EVENT_SHUTDOWN);
 	json_object_put(json);
 }
 
@@ -478,8 +815,7 @@ void ipc_event_binding(struct sway_binding *binding) {
 	json_object *json = json_object_new_object();
 	json_object_object_add(json, "change", json_object_new_string("run"));
 	json_object_object_add(json, "binding", json_binding);
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_BINDING);
+	ipc_send_event(json, IPC_EVENT_BINDING);
 	json_object_put(json);
 }
 
@@ -493,8 +829,7 @@ static void ipc_event_tick(const char *payload) {
 	json_object_object_add(json, "first", json_object_new_boolean(false));
 	json_object_object_add(json, "payload", json_object_new_string(payload));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_TICK);
+	ipc_send_event(json, IPC_EVENT_TICK);
 	json_object_put(json);
 }
 
@@ -508,8 +843,63 @@ void ipc_event_input(const char *change, struct sway_input_device *device) {
 	json_object_object_add(json, "change", json_object_new_string(change));
 	json_object_object_add(json, "input", ipc_json_describe_input(device));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_INPUT);
+	ipc_send_event(json, IPC_EVENT_INPUT);
+	json_object_put(json);
+}
+
+void ipc_event_tree_delta(void) {
+	if (!ipc_has_event_listeners(IPC_EVENT_TREE_DELTA)) {
+		for (int i = 0; i < tree_delta_nodes->length; ++i) {
+			struct sway_node *node = tree_delta_nodes->items[i];
+			node->ipc_delta_pending = false;
+		}
+		tree_delta_nodes->length = 0;
+		return;
+	}
+
+	struct sway_seat *seat = input_manager_get_default_seat();
+	struct sway_node *focus = seat_get_focus(seat);
+	size_t focused = focus ? focus->id : 0;
+	if (!tree_delta_nodes->length && focused == tree_delta_focused) {
+		return;
+	}
+
+	json_object *changed = json_object_new_array();
+	json_object *removed = json_object_new_array();
+	for (int i = 0; i < tree_delta_nodes->length; ++i) {
+		struct sway_node *node = tree_delta_nodes->items[i];
+		node->ipc_delta_pending = false;
+		if (node->destroying) {
+			json_object_array_add(removed, json_object_new_int(node->id));
+			json_object_put(node->ipc_delta_state);
+			node->ipc_delta_state = NULL;
+			continue;
+		}
+		json_object *changes = ipc_tree_delta_describe(node);
+		if (changes) {
+			json_object_array_add(changed, changes);
+		}
+	}
+	tree_delta_nodes->length = 0;
+
+	if (json_object_array_length(changed) == 0 &&
+			json_object_array_length(removed) == 0 &&
+			focused == tree_delta_focused) {
+		json_object_put(changed);
+		json_object_put(removed);
+		return;
+	}
+	tree_delta_focused = focused;
+
+	json_object *json = json_object_new_object();
+	json_object_object_add(json, "generation",
+			json_object_new_int64(++root->generation));
+	json_object_object_add(json, "focused",
+			focus ? json_object_new_int(focused) : NULL);
+	json_object_object_add(json, "changed", changed);
+	json_object_object_add(json, "removed", removed);
+
+	ipc_send_event(json, IPC_EVENT_TREE_DELTA);
 	json_object_put(json);
 }
 
@@ -528,13 +918,23 @@ int ipc_client_handle_writable(int client_fd, uint32_t mask, void *data) {
 		return 0;
 	}
 
-	if (client->write_buffer_len <= 0) {
+	if (client->write_queue->length == 0) {
 		return 0;
 	}
 
 	sway_log(SWAY_DEBUG, "Client %d writable", client->fd);
 
-	ssize_t written = write(client->fd, client->write_buffer, client->write_buffer_len);
+	struct iovec iov[IPC_WRITEV_MAX];
+	int iovcnt = 0;
+	for (int i = 0; i < client->write_queue->length && i < IPC_WRITEV_MAX; ++i) {
+		struct ipc_payload *p = client->write_queue->items[i];
+		size_t offset = i == 0 ? client->write_offset : 0;
+		iov[iovcnt].iov_base = p->data + offset;
+		iov[iovcnt].iov_len = p->size - offset;
+		++iovcnt;
+	}
+
+	ssize_t written = writev(client->fd, iov, iovcnt);
 
 	if (written == -1 && errno == EAGAIN) {
 		return 0;
@@ -544,10 +944,29 @@ int ipc_client_handle_writable(int client_fd, uint32_t mask, void *data) {
 		return 0;
 	}
 
-	memmove(client->write_buffer, client->write_buffer + written, client->write_buffer_len - written);
-	client->write_buffer_len -= written;
+	// Drop the payloads which have been sent completely
+	client->write_queued -= written;
+	size_t remaining = written;
+	int sent = 0;
+	while (sent < iovcnt && remaining >= iov[sent].iov_len) {
+		remaining -= iov[sent].iov_len;
+		ipc_payload_unref(client->write_queue->items[sent]);
+		++sent;
+	}
+	client->write_offset = (sent == 0 ? client->write_offset : 0) + remaining;
+	if (sent > 0) {
+		list_t *queue = client->write_queue;
+		memmove(queue->items, queue->items + sent,
+			(queue->length - sent) * sizeof(void *));
+		queue->length -= sent;
+	}
+
+	if (client->events_dropped > 0 &&
+			client->write_queued <= IPC_RESUME_QUEUED_BYTES) {
+		ipc_client_send_overflow(client);
+	}
 
-	if (client->write_buffer_len == 0 && client->writable_event_source) {
+	if (client->write_queue->length == 0 && client->writable_event_source) {
 		wl_event_source_remove(client->writable_event_source);
 		client->writable_event_source = NULL;
 	}
@@ -572,7 +991,15 @@ void ipc_client_disconnect(struct ipc_client *client) {
 		i++;
 	}
 	list_del(ipc_client_list, i);
-	free(client->write_buffer);
+	for (int j = 0; j < IPC_EVENT_TYPES; ++j) {
+		if (client->subscribed_events & (1u << j)) {
+			ipc_event_listeners[j]--;
+		}
+	}
+	for (int j = 0; j < client->write_queue->length; ++j) {
+		ipc_payload_unref(client->write_queue->items[j]);
+	}
+	list_free(client->write_queue);
 	close(client->fd);
 	free(client);
 }
@@ -590,6 +1017,14 @@ static void ipc_get_workspaces_callback(struct sway_workspace *workspace,
 			json_object_new_boolean(focused));
 	json_object_array_add((json_object *)data, workspace_json);
 
+	json_object *floating = json_object_new_array();
+	for (int i = 0; i < workspace->floating->length; ++i) {
+		struct sway_container *floater = workspace->floating->items[i];
+		json_object_array_add(floating,
+				ipc_json_describe_node_recursive(&floater->node));
+	}
+	json_object_object_add(workspace_json, "floating_nodes", floating);
+
 	focused_ws = output_get_active_workspace(workspace->output);
 	bool visible = workspace == focused_ws;
 	json_object_object_add(workspace_json, "visible",
@@ -604,6 +1039,125 @@ static void ipc_get_marks_callback(struct sway_container *con, void *data) {
 	}
 }
 
+static void ipc_send_error_reply(struct ipc_client *client,
+		enum ipc_command_type payload_type, const char *error) {
+	json_object *reply = json_object_new_object();
+	json_object_object_add(reply, "success", json_object_new_boolean(false));
+	json_object_object_add(reply, "error", json_object_new_string(error));
+	ipc_send_reply_json(client, payload_type, reply);
+	json_object_put(reply);
+}
+
+static bool find_container_by_id(struct sway_container *con, void *data) {
+	size_t *id = data;
+	return con->node.id == *id;
+}
+
+static struct sway_node *ipc_find_node(size_t id) {
+	if (root->node.id == id) {
+		return &root->node;
+	}
+	for (int i = 0; i < root->outputs->length; ++i) {
+		struct sway_output *output = root->outputs->items[i];
+		if (output->node.id == id) {
+			return &output->node;
+		}
+		for (int j = 0; j < output->workspaces->length; ++j) {
+			struct sway_workspace *ws = output->workspaces->items[j];
+			if (ws->node.id == id) {
+				return &ws->node;
+			}
+		}
+	}
+	struct sway_container *con = root_find_container(find_container_by_id, &id);
+	return con ? &con->node : NULL;
+}
+
+/**
+ * Parse a get_tree query, which is a JSON object with the optional members
+ * con_id or criteria, depth and fields. The field names in the query point
+ * into the request, which must be kept until the query is finished.
+ *
+ * Returns an error message which must be freed, or NULL on success.
+ */
+static char *ipc_parse_tree_query(const char *buf,
+		struct ipc_tree_query *query, json_object **request) {
+	*request = json_tokener_parse(buf);
+	if (*request == NULL || !json_object_is_type(*request, json_type_object)) {
+		return strdup("Expected a JSON object");
+	}
+
+	json_object *depth;
+	if (json_object_object_get_ex(*request, "depth", &depth)) {
+		if (!json_object_is_type(depth, json_type_int) ||
+				json_object_get_int(depth) < 0) {
+			return strdup("Expected depth to be a non-negative integer");
+		}
+		query->depth = json_object_get_int(depth);
+	}
+
+	json_object *fields;
+	if (json_object_object_get_ex(*request, "fields", &fields)) {
+		if (!json_object_is_type(fields, json_type_array)) {
+			return strdup("Expected fields to be an array of strings");
+		}
+		query->fields = create_list();
+		for (size_t i = 0; i < json_object_array_length(fields); i++) {
+			json_object *field = json_object_array_get_idx(fields, i);
+			if (!json_object_is_type(field, json_type_string)) {
+				return strdup("Expected fields to be an array of strings");
+			}
+			list_add(query->fields, (void *)json_object_get_string(field));
+		}
+	}
+
+	json_object *con_id, *criteria_string;
+	bool has_con_id =
+		json_object_object_get_ex(*request, "con_id", &con_id);
+	bool has_criteria =
+		json_object_object_get_ex(*request, "criteria", &criteria_string);
+	if (has_con_id && has_criteria) {
+		return strdup("Expected either con_id or criteria, not both");
+	}
+	if (has_con_id) {
+		if (!json_object_is_type(con_id, json_type_int)) {
+			return strdup("Expected con_id to be an integer");
+		}
+		query->nodes = create_list();
+		struct sway_node *node = ipc_find_node(json_object_get_int64(con_id));
+		if (node) {
+			list_add(query->nodes, node);
+		}
+	} else if (has_criteria) {
+		if (!json_object_is_type(criteria_string, json_type_string)) {
+			return strdup("Expected criteria to be a string");
+		}
+		char *raw = strdup(json_object_get_string(criteria_string));
+		char *error = NULL;
+		struct criteria *criteria = criteria_parse(raw, &error);
+		free(raw);
+		if (!criteria) {
+			return error;
+		}
+		list_t *containers = criteria_get_containers(criteria);
+		criteria_destroy(criteria);
+		query->nodes = create_list();
+		for (int i = 0; i < containers->length; ++i) {
+			struct sway_container *con = containers->items[i];
+			list_add(query->nodes, &con->node);
+		}
+		list_free(containers);
+	}
+	return NULL;
+}
+
+static void ipc_tree_query_finish(struct ipc_tree_query *query,
+		json_object *request) {
+	list_free(query->nodes);
+	list_free(query->fields);
+	json_object_put(request);
+}
+
 void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_length,
 		enum ipc_command_type payload_type) {
 	if (!sway_assert(client != NULL, "client != NULL")) {
@@ -692,9 +1246,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 						ipc_json_describe_disabled_output(output));
 			}
 		}
-		const char *json_string = json_object_to_json_string(outputs);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, outputs);
 		json_object_put(outputs); // free
 		goto exit_cleanup;
 	}
@@ -703,9 +1255,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	{
 		json_object *workspaces = json_object_new_array();
 		root_for_each_workspace(ipc_get_workspaces_callback, workspaces);
-		const char *json_string = json_object_to_json_string(workspaces);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, workspaces);
 		json_object_put(workspaces); // free
 		goto exit_cleanup;
 	}
@@ -714,36 +1264,47 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	{
 		// TODO: Check if they're permitted to use these events
 		struct json_object *request = json_tokener_parse(buf);
-		if (request == NULL || !json_object_is_type(request, json_type_array)) {
+		// Either an array of events, or an object holding the array along
+		// with options
+		struct json_object *events = request, *coalesce = NULL;
+		if (json_object_is_type(request, json_type_object)) {
+			json_object_object_get_ex(request, "events", &events);
+			json_object_object_get_ex(request, "coalesce", &coalesce);
+		}
+		if (events == NULL || !json_object_is_type(events, json_type_array) ||
+				(coalesce && !json_object_is_type(coalesce, json_type_boolean))) {
 			const char msg[] = "{\"success\": false}";
 			ipc_send_reply(client, payload_type, msg, strlen(msg));
+			json_object_put(request);
 			sway_log(SWAY_INFO, "Failed to parse subscribe request");
 			goto exit_cleanup;
 		}
 
 		bool is_tick = false;
 		// parse requested event types
-		for (size_t i = 0; i < json_object_array_length(request); i++) {
-			const char *event_type = json_object_get_string(json_object_array_get_idx(request, i));
+		for (size_t i = 0; i < json_object_array_length(events); i++) {
+			const char *event_type = json_object_get_string(json_object_array_get_idx(events, i));
 			if (strcmp(event_type, "workspace") == 0) {
-				client->subscribed_events |= event_mask(IPC_EVENT_WORKSPACE);
+				ipc_client_subscribe(client, IPC_EVENT_WORKSPACE);
 			} else if (strcmp(event_type, "barconfig_update") == 0) {
-				client->subscribed_events |= event_mask(IPC_EVENT_BARCONFIG_UPDATE);
+				ipc_client_subscribe(client, IPC_EVENT_BARCONFIG_UPDATE);
 			} else if (strcmp(event_type, "bar_state_update") == 0) {
-				client->subscribed_events |= event_mask(IPC_EVENT_BAR_STATE_UPDATE);
+				ipc_client_subscribe(client, IPC_EVENT_BAR_STATE_UPDATE);
 			} else if (strcmp(event_type, "mode") == 0) {
-				client->subscribed_events |= event_mask(IPC_EVENT_MODE);
+				ipc_client_subscribe(client, IPC_EVENT_MODE);
 			} else if (strcmp(event_type, "shutdown") == 0) {
-				client->subscribed_events |= event_mask(IPC_EVENT_SHUTDOWN);
+				ipc_client_subscribe(client, IPC_EVENT_SHUTDOWN);
 			} else if (strcmp(event_type, "window") == 0) {
-				client->subscribed_events |= event_mask(IPC_EVENT_WINDOW);
+				ipc_client_subscribe(client, IPC_EVENT_WINDOW);
 			} else if (strcmp(event_type, "binding") == 0) {
-				client->subscribed_events |= event_mask(IPC_EVENT_BINDING);
+				ipc_client_subscribe(client, IPC_EVENT_BINDING);
 			} else if (strcmp(event_type, "tick") == 0) {
-				client->subscribed_events |= event_mask(IPC_EVENT_TICK);
+				ipc_client_subscribe(client, IPC_EVENT_TICK);
 				is_tick = true;
 			} else if (strcmp(event_type, "input") == 0) {
-				client->subscribed_events |= event_mask(IPC_EVENT_INPUT);
+				ipc_client_subscribe(client, IPC_EVENT_INPUT);
+			} else if (strcmp(event_type, "tree_delta") == 0) {
+				ipc_client_subscribe(client, IPC_EVENT_TREE_DELTA);
 			} else {
 				const char msg[] = "{\"success\": false}";
 				ipc_send_reply(client, payload_type, msg, strlen(msg));
@@ -753,6 +1314,9 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 			}
 		}
 
+		if (coalesce) {
+			client->coalesce = json_object_get_boolean(coalesce);
+		}
 		json_object_put(request);
 		const char msg[] = "{\"success\": true}";
 		ipc_send_reply(client, payload_type, msg, strlen(msg));
@@ -771,9 +1335,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 		wl_list_for_each(device, &server.input->devices, link) {
 			json_object_array_add(inputs, ipc_json_describe_input(device));
 		}
-		const char *json_string = json_object_to_json_string(inputs);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, inputs);
 		json_object_put(inputs); // free
 		goto exit_cleanup;
 	}
@@ -785,20 +1347,82 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 		wl_list_for_each(seat, &server.input->seats, link) {
 			json_object_array_add(seats, ipc_json_describe_seat(seat));
 		}
-		const char *json_string = json_object_to_json_string(seats);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, seats);
 		json_object_put(seats); // free
 		goto exit_cleanup;
 	}
 
+	case IPC_GET_RENDER_STATS:
+	{
+		bool reset = strcmp(buf, "reset") == 0;
+		if (!reset && buf[0] != '\0') {
+			const char msg[] = "{\"success\": false, "
+				"\"error\": \"Unknown payload, expected nothing or reset\"}";
+			ipc_send_reply(client, payload_type, msg, strlen(msg));
+			goto exit_cleanup;
+		}
+		json_object *outputs = json_object_new_array();
+		for (int i = 0; i < root->outputs->length; ++i) {
+			struct sway_output *output = root->outputs->items[i];
+			json_object_array_add(outputs,
+				ipc_json_describe_render_stats(output));
+			if (reset) {
+				render_stats_reset(&output->render_stats);
+			}
+		}
+		ipc_send_reply_json(client, payload_type, outputs);
+		json_object_put(outputs); // free
+		goto exit_cleanup;
+	}
+
+	case IPC_GET_TRANSACTION_TRACE:
+	{
+		bool clear = strcmp(buf, "clear") == 0;
+		if (!clear && buf[0] != '\0') {
+			const char msg[] = "{\"success\": false, "
+				"\"error\": \"Unknown payload, expected nothing or clear\"}";
+			ipc_send_reply(client, payload_type, msg, strlen(msg));
+			goto exit_cleanup;
+		}
+		json_object *trace = ipc_json_describe_transaction_trace();
+		if (clear) {
+			transaction_trace_clear();
+		}
+		ipc_send_reply_json(client, payload_type, trace);
+		json_object_put(trace); // free
+		goto exit_cleanup;
+	}
+
 	case IPC_GET_TREE:
 	{
-		json_object *tree = ipc_json_describe_node_recursive(&root->node);
-		const char *json_string = json_object_to_json_string(tree);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
-		json_object_put(tree);
+		struct ipc_tree_query query = { .depth = -1 };
+		json_object *request = NULL;
+		if (buf[0] != '\0') {
+			char *error = ipc_parse_tree_query(buf, &query, &request);
+			if (error) {
+				ipc_send_error_reply(client, payload_type, error);
+				free(error);
+				ipc_tree_query_finish(&query, request);
+				goto exit_cleanup;
+			}
+		}
+		if (client->encoding != IPC_ENCODING_JSON) {
+			// Built as an object so it isn't parsed again to transcode it
+			json_object *tree = ipc_json_describe_tree(&query);
+			ipc_send_reply_json(client, payload_type, tree);
+			json_object_put(tree);
+			ipc_tree_query_finish(&query, request);
+			goto exit_cleanup;
+		}
+		size_t length;
+		const char *json_string = ipc_json_serialize_tree(&query, &length);
+		if (json_string) {
+			ipc_send_reply(client, payload_type, json_string, (uint32_t)length);
+		} else {
+			ipc_send_error_reply(client, payload_type,
+					"Unable to serialize tree");
+		}
+		ipc_tree_query_finish(&query, request);
 		goto exit_cleanup;
 	}
 
@@ -806,9 +1430,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	{
 		json_object *marks = json_object_new_array();
 		root_for_each_container(ipc_get_marks_callback, marks);
-		const char *json_string = json_object_to_json_string(marks);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, marks);
 		json_object_put(marks);
 		goto exit_cleanup;
 	}
@@ -816,9 +1438,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	case IPC_GET_VERSION:
 	{
 		json_object *version = ipc_json_get_version();
-		const char *json_string = json_object_to_json_string(version);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, version);
 		json_object_put(version); // free
 		goto exit_cleanup;
 	}
@@ -832,9 +1452,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 				struct bar_config *bar = config->bars->items[i];
 				json_object_array_add(bars, json_object_new_string(bar->id));
 			}
-			const char *json_string = json_object_to_json_string(bars);
-			ipc_send_reply(client, payload_type, json_string,
-				(uint32_t)strlen(json_string));
+			ipc_send_reply_json(client, payload_type, bars);
 			json_object_put(bars); // free
 		} else {
 			// Send particular bar's details
@@ -853,9 +1471,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 				goto exit_cleanup;
 			}
 			json_object *json = ipc_json_describe_bar_config(bar);
-			const char *json_string = json_object_to_json_string(json);
-			ipc_send_reply(client, payload_type, json_string,
-				(uint32_t)strlen(json_string));
+			ipc_send_reply_json(client, payload_type, json);
 			json_object_put(json); // free
 		}
 		goto exit_cleanup;
@@ -868,9 +1484,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 			struct sway_mode *mode = config->modes->items[i];
 			json_object_array_add(modes, json_object_new_string(mode->name));
 		}
-		const char *json_string = json_object_to_json_string(modes);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, modes);
 		json_object_put(modes); // free
 		goto exit_cleanup;
 	}
@@ -878,9 +1492,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	case IPC_GET_BINDING_STATE:
 	{
 		json_object *current_mode = ipc_json_get_binding_mode();
-		const char *json_string = json_object_to_json_string(current_mode);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, current_mode);
 		json_object_put(current_mode); // free
 		goto exit_cleanup;
 	}
@@ -889,13 +1501,31 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	{
 		json_object *json = json_object_new_object();
 		json_object_object_add(json, "config", json_object_new_string(config->current_config));
-		const char *json_string = json_object_to_json_string(json);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_reply_json(client, payload_type, json);
 		json_object_put(json); // free
 		goto exit_cleanup;
 	}
 
+	case IPC_SET_ENCODING:
+	{
+		enum ipc_encoding encoding;
+		if (strcmp(buf, "json") == 0) {
+			encoding = IPC_ENCODING_JSON;
+		} else if (strcmp(buf, "cbor") == 0) {
+			encoding = IPC_ENCODING_CBOR;
+		} else {
+			ipc_send_error_reply(client, payload_type, "Unknown encoding");
+			goto exit_cleanup;
+		}
+		// The reply still uses the previous encoding, so that the client
+		// knows how to read it whether or not the switch succeeded
+		const char msg[] = "{\"success\": true}";
+		if (ipc_send_reply(client, payload_type, msg, strlen(msg))) {
+			client->encoding = encoding;
+		}
+		goto exit_cleanup;
+	}
+
 	case IPC_SYNC:
 	{
 		// It was decided sway will not support this, just return success:false
@@ -918,44 +1548,58 @@ bool ipc_send_reply(struct ipc_client *client, enum ipc_command_type payload_typ
 		const char *payload, uint32_t payload_length) {
 	assert(payload);
 
-	char data[IPC_HEADER_SIZE];
-
-	memcpy(data, ipc_magic, sizeof(ipc_magic));
-	memcpy(data + sizeof(ipc_magic), &payload_length, sizeof(payload_length));
-	memcpy(data + sizeof(ipc_magic) + sizeof(payload_length), &payload_type, sizeof(payload_type));
-
-	while (client->write_buffer_len + IPC_HEADER_SIZE + payload_length >=
-				 client->write_buffer_size) {
-		client->write_buffer_size *= 2;
+	struct ipc_payload *p;
+	if (client->encoding == IPC_ENCODING_JSON) {
+		p = ipc_payload_create(payload_type, payload, payload_length);
+	} else {
+		// Replies which are only available as JSON text are transcoded
+		json_object *obj = NULL;
+		struct json_tokener *tok = json_tokener_new();
+		if (tok) {
+			obj = json_tokener_parse_ex(tok, payload, (int)payload_length);
+			if (json_tokener_get_error(tok) != json_tokener_success) {
+				sway_log(SWAY_ERROR, "Unable to transcode IPC reply: %s",
+					json_tokener_error_desc(json_tokener_get_error(tok)));
+				json_object_put(obj);
+				obj = NULL;
+			}
+			json_tokener_free(tok);
+		}
+		p = obj ? ipc_payload_create_json(payload_type, obj, client->encoding)
+			: NULL;
+		json_object_put(obj);
 	}
-
-	if (client->write_buffer_size > 4e6) { // 4 MB
-		sway_log(SWAY_ERROR, "Client write buffer too big (%zu), disconnecting client",
-				client->write_buffer_size);
+	if (!p) {
 		ipc_client_disconnect(client);
 		return false;
 	}
-
-	char *new_buffer = realloc(client->write_buffer, client->write_buffer_size);
-	if (!new_buffer) {
-		sway_log(SWAY_ERROR, "Unable to reallocate ipc client write buffer");
-		ipc_client_disconnect(client);
+	bool queued = ipc_client_queue_payload(client, p);
+	ipc_payload_unref(p);
+	if (!queued) {
 		return false;
 	}
-	client->write_buffer = new_buffer;
 
-	memcpy(client->write_buffer + client->write_buffer_len, data, IPC_HEADER_SIZE);
-	client->write_buffer_len += IPC_HEADER_SIZE;
-	memcpy(client->write_buffer + client->write_buffer_len, payload, payload_length);
-	client->write_buffer_len += payload_length;
+	sway_log(SWAY_DEBUG, "Added IPC reply of type 0x%x to client %d queue: %s",
+		payload_type, client->fd, payload);
+	return true;
+}
 
-	if (!client->writable_event_source) {
-		client->writable_event_source = wl_event_loop_add_fd(
-				server.wl_event_loop, client->fd, WL_EVENT_WRITABLE,
-				ipc_client_handle_writable, client);
+bool ipc_send_reply_json(struct ipc_client *client,
+		enum ipc_command_type payload_type, json_object *obj) {
+	struct ipc_payload *p =
+		ipc_payload_create_json(payload_type, obj, client->encoding);
+	if (!p) {
+		ipc_client_disconnect(client);
+		return false;
+	}
+	size_t size = p->size;
+	bool queued = ipc_client_queue_payload(client, p);
+	ipc_payload_unref(p);
+	if (!queued) {
+		return false;
 	}
 
-	sway_log(SWAY_DEBUG, "Added IPC reply of type 0x%x to client %d queue: %s",
-		payload_type, client->fd, payload);
+	sway_log(SWAY_DEBUG, "Added IPC reply of type 0x%x to client %d queue "
+		"(%zu bytes)", payload_type, client->fd, size);
 	return true;
 }
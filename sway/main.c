@@ -1,5 +1,6 @@
 #define _POSIX_C_SOURCE 200809L
 #include <getopt.h>
+#include <inttypes.h>
 #include <pango/pangocairo.h>
 #include <signal.h>
 #include <stdbool.h>
@@ -21,6 +22,7 @@
 #include "sway/ipc-server.h"
 #include "ipc-client.h"
 #include "log.h"
+#include "pango.h"
 #include "stringop.h"
 #include "util.h"
 
@@ -214,6 +216,8 @@ void enable_debug_flag(const char *flag) {
 		debug.noatomic = true;
 	} else if (strcmp(flag, "txn-wait") == 0) {
 		debug.txn_wait = true;
+	} else if (strcmp(flag, "noquarantine") == 0) {
+		debug.noquarantine = true;
 	} else if (strcmp(flag, "txn-timings") == 0) {
 		debug.txn_timings = true;
 	} else if (strncmp(flag, "txn-timeout=", 12) == 0) {
@@ -411,6 +415,16 @@ int main(int argc, char **argv) {
 
 	server_run(&server);
 
+	struct pango_cache_stats pango_stats;
+	get_pango_cache_stats(&pango_stats);
+	sway_log(SWAY_DEBUG, "Pango caches: font descriptions %" PRIu64 " hits, "
+			"%" PRIu64 " misses; text sizes %" PRIu64 " hits, %" PRIu64
+			" misses; %" PRIu64 " layout reuses",
+			pango_stats.font_description_hits,
+			pango_stats.font_description_misses,
+			pango_stats.text_size_hits, pango_stats.text_size_misses,
+			pango_stats.layout_reuses);
+
 shutdown:
 	sway_log(SWAY_INFO, "Shutting down sway");
 
@@ -421,6 +435,7 @@ shutdown:
 	free(config_path);
 	free_config(config);
 
+	pango_cache_fini();
 	pango_cairo_font_map_set_default(NULL);
 
 	return exit_value;
@@ -28,6 +28,7 @@
 #include <wlr/types/wlr_xdg_output_v1.h>
 #include "config.h"
 #include "list.h"
+#include "sway/desktop/transaction.h"
 #include "log.h"
 #include "sway/config.h"
 #include "sway/desktop/idle_inhibit_v1.h"
@@ -174,6 +175,8 @@ bool server_init(struct sway_server *server) {
 
 	server->dirty_nodes = create_list();
 	server->transactions = create_list();
+	server->txn_client_stats = create_list();
+	server->pending_titles = create_list();
 
 	server->input = input_manager_create(server);
 	input_manager_get_default_seat(); // create seat0
@@ -183,6 +186,12 @@ bool server_init(struct sway_server *server) {
 
 void server_fini(struct sway_server *server) {
 	// TODO: free sway-specific resources
+	if (server->title_update_timer) {
+		wl_event_source_remove(server->title_update_timer);
+	}
+	if (server->occluded_frame_timer) {
+		wl_event_source_remove(server->occluded_frame_timer);
+	}
 #if HAVE_XWAYLAND
 	wlr_xwayland_destroy(server->xwayland.wlr_xwayland);
 #endif
@@ -190,6 +199,13 @@ void server_fini(struct sway_server *server) {
 	wl_display_destroy(server->wl_display);
 	list_free(server->dirty_nodes);
 	list_free(server->transactions);
+	for (int i = 0; i < server->txn_client_stats->length; ++i) {
+		struct sway_txn_client_stats *stats = server->txn_client_stats->items[i];
+		free(stats->app_id);
+		free(stats);
+	}
+	list_free(server->txn_client_stats);
+	list_free(server->pending_titles);
 }
 
 bool server_start(struct sway_server *server) {
@@ -10,6 +10,7 @@
 #include "pango.h"
 #include "sway/config.h"
 #include "sway/desktop.h"
+#include "sway/desktop/title_texture.h"
 #include "sway/desktop/transaction.h"
 #include "sway/input/input-manager.h"
 #include "sway/input/seat.h"
@@ -36,7 +37,7 @@ struct sway_container *container_create(struct sway_view *view) {
 
 	if (!view) {
 		c->children = create_list();
-		c->current.children = create_list();
+		c->current.children = node_state_list_share(NULL, c->children);
 	}
 	c->marks = create_list();
 	c->outputs = create_list();
@@ -56,21 +57,24 @@ void container_destroy(struct sway_container *con) {
 				"which is still referenced by transactions")) {
 		return;
 	}
+	node_invalidate_ipc_json(&con->node);
+	ipc_tree_delta_forget(&con->node);
 	free(con->title);
 	free(con->formatted_title);
-	wlr_texture_destroy(con->title_focused);
-	wlr_texture_destroy(con->title_focused_inactive);
-	wlr_texture_destroy(con->title_unfocused);
-	wlr_texture_destroy(con->title_urgent);
+	title_texture_unref(con->title_focused);
+	title_texture_unref(con->title_focused_inactive);
+	title_texture_unref(con->title_unfocused);
+	title_texture_unref(con->title_urgent);
 	list_free(con->children);
-	list_free(con->current.children);
+	node_state_list_unref(con->current.children);
 	list_free(con->outputs);
 
 	list_free_items_and_destroy(con->marks);
-	wlr_texture_destroy(con->marks_focused);
-	wlr_texture_destroy(con->marks_focused_inactive);
-	wlr_texture_destroy(con->marks_unfocused);
-	wlr_texture_destroy(con->marks_urgent);
+	free(con->formatted_marks);
+	title_texture_unref(con->marks_focused);
+	title_texture_unref(con->marks_focused_inactive);
+	title_texture_unref(con->marks_unfocused);
+	title_texture_unref(con->marks_urgent);
 
 	if (con->view) {
 		if (con->view->container == con) {
@@ -104,6 +108,8 @@ void container_begin_destroy(struct sway_container *con) {
 	con->node.destroying = true;
 	node_set_dirty(&con->node);
 
+	config_remove_title_metrics(con->title_height, con->title_baseline);
+
 	if (con->scratchpad) {
 		root_scratchpad_remove_container(con);
 	}
@@ -446,89 +452,79 @@ struct sway_output *container_get_effective_output(struct sway_container *con) {
 	return con->outputs->items[con->outputs->length - 1];
 }
 
-static void update_title_texture(struct sway_container *con,
-		struct wlr_texture **texture, struct border_colors *class) {
+static struct sway_title_texture **get_title_texture_slot(
+		struct sway_container *con, struct border_colors *class, bool marks) {
+	if (class == &config->border_colors.focused) {
+		return marks ? &con->marks_focused : &con->title_focused;
+	} else if (class == &config->border_colors.focused_inactive) {
+		return marks ? &con->marks_focused_inactive :
+			&con->title_focused_inactive;
+	} else if (class == &config->border_colors.urgent) {
+		return marks ? &con->marks_urgent : &con->title_urgent;
+	}
+	return marks ? &con->marks_unfocused : &con->title_unfocused;
+}
+
+static void prepare_title_texture(struct sway_output *output,
+		struct sway_title_texture **texture, const char *text,
+		bool pango_markup, int height, struct border_colors *class) {
+	if (*texture || !text || !text[0]) {
+		return;
+	}
+	*texture = title_texture_get(output, text, pango_markup, height, class);
+}
+
+void container_prepare_title_textures(struct sway_container *con,
+		struct border_colors *class) {
 	struct sway_output *output = container_get_effective_output(con);
 	if (!output) {
 		return;
 	}
-	if (*texture) {
-		wlr_texture_destroy(*texture);
-		*texture = NULL;
+	prepare_title_texture(output, get_title_texture_slot(con, class, false),
+			con->formatted_title, config->pango_markup, con->title_height,
+			class);
+	if (config->show_marks) {
+		prepare_title_texture(output, get_title_texture_slot(con, class, true),
+				con->formatted_marks, false, con->title_height, class);
 	}
-	if (!con->formatted_title) {
-		return;
+}
+
+struct sway_title_texture *container_get_title_texture(
+		struct sway_container *con, struct border_colors *class) {
+	return *get_title_texture_slot(con, class, false);
+}
+
+struct sway_title_texture *container_get_marks_texture(
+		struct sway_container *con, struct border_colors *class) {
+	if (!config->show_marks) {
+		return NULL;
 	}
+	return *get_title_texture_slot(con, class, true);
+}
 
-	double scale = output->wlr_output->scale;
-	int width = 0;
-	int height = con->title_height * scale;
-
-	// We must use a non-nil cairo_t for cairo_set_font_options to work.
-	// Therefore, we cannot use cairo_create(NULL).
-	cairo_surface_t *dummy_surface = cairo_image_surface_create(
-			CAIRO_FORMAT_ARGB32, 0, 0);
-	cairo_t *c = cairo_create(dummy_surface);
-	cairo_set_antialias(c, CAIRO_ANTIALIAS_BEST);
-	cairo_font_options_t *fo = cairo_font_options_create();
-	cairo_font_options_set_hint_style(fo, CAIRO_HINT_STYLE_FULL);
-	if (output->wlr_output->subpixel == WL_OUTPUT_SUBPIXEL_NONE) {
-		cairo_font_options_set_antialias(fo, CAIRO_ANTIALIAS_GRAY);
-	} else {
-		cairo_font_options_set_antialias(fo, CAIRO_ANTIALIAS_SUBPIXEL);
-		cairo_font_options_set_subpixel_order(fo,
-			to_cairo_subpixel_order(output->wlr_output->subpixel));
-	}
-	cairo_set_font_options(c, fo);
-	get_text_size(c, config->font, &width, NULL, NULL, scale,
-			config->pango_markup, "%s", con->formatted_title);
-	cairo_surface_destroy(dummy_surface);
-	cairo_destroy(c);
-
-	cairo_surface_t *surface = cairo_image_surface_create(
-			CAIRO_FORMAT_ARGB32, width, height);
-	cairo_t *cairo = cairo_create(surface);
-	cairo_set_antialias(cairo, CAIRO_ANTIALIAS_BEST);
-	cairo_set_font_options(cairo, fo);
-	cairo_font_options_destroy(fo);
-	cairo_set_source_rgba(cairo, class->background[0], class->background[1],
-			class->background[2], class->background[3]);
-	cairo_paint(cairo);
-	PangoContext *pango = pango_cairo_create_context(cairo);
-	cairo_set_source_rgba(cairo, class->text[0], class->text[1],
-			class->text[2], class->text[3]);
-	cairo_move_to(cairo, 0, 0);
-
-	pango_printf(cairo, config->font, scale, config->pango_markup,
-			"%s", con->formatted_title);
-
-	cairo_surface_flush(surface);
-	unsigned char *data = cairo_image_surface_get_data(surface);
-	int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
-	struct wlr_renderer *renderer = wlr_backend_get_renderer(
-			output->wlr_output->backend);
-	*texture = wlr_texture_from_pixels(
-			renderer, WL_SHM_FORMAT_ARGB8888, stride, width, height, data);
-	cairo_surface_destroy(surface);
-	g_object_unref(pango);
-	cairo_destroy(cairo);
+static void clear_title_texture(struct sway_title_texture **texture) {
+	title_texture_unref(*texture);
+	*texture = NULL;
 }
 
 void container_update_title_textures(struct sway_container *container) {
-	update_title_texture(container, &container->title_focused,
-			&config->border_colors.focused);
-	update_title_texture(container, &container->title_focused_inactive,
-			&config->border_colors.focused_inactive);
-	update_title_texture(container, &container->title_unfocused,
-			&config->border_colors.unfocused);
-	update_title_texture(container, &container->title_urgent,
-			&config->border_colors.urgent);
+	clear_title_texture(&container->title_focused);
+	clear_title_texture(&container->title_focused_inactive);
+	clear_title_texture(&container->title_unfocused);
+	clear_title_texture(&container->title_urgent);
 	container_damage_whole(container);
 }
 
 void container_calculate_title_height(struct sway_container *container) {
+	if (container->node.destroying) {
+		// Its metrics have already been removed from the font height
+		return;
+	}
+	config_remove_title_metrics(container->title_height,
+			container->title_baseline);
 	if (!container->formatted_title) {
 		container->title_height = 0;
+		container->title_baseline = 0;
 		return;
 	}
 	cairo_t *cairo = cairo_create(NULL);
@@ -539,6 +535,8 @@ void container_calculate_title_height(struct sway_container *container) {
 	cairo_destroy(cairo);
 	container->title_height = height;
 	container->title_baseline = baseline;
+	config_add_title_metrics(container->title_height,
+			container->title_baseline);
 }
 
 /**
@@ -1266,6 +1264,137 @@ list_t *container_get_current_siblings(struct sway_container *container) {
 	return container->current.workspace->current.tiling;
 }
 
+static void box_add(struct wlr_box *bounds, const struct wlr_box *box) {
+	if (box->width <= 0 || box->height <= 0) {
+		return;
+	}
+	if (bounds->width <= 0 || bounds->height <= 0) {
+		*bounds = *box;
+		return;
+	}
+	int x1 = bounds->x < box->x ? bounds->x : box->x;
+	int y1 = bounds->y < box->y ? bounds->y : box->y;
+	int x2 = bounds->x + bounds->width;
+	int y2 = bounds->y + bounds->height;
+	if (box->x + box->width > x2) {
+		x2 = box->x + box->width;
+	}
+	if (box->y + box->height > y2) {
+		y2 = box->y + box->height;
+	}
+	*bounds = (struct wlr_box){ x1, y1, x2 - x1, y2 - y1 };
+}
+
+static void set_titlebar_geometry(struct sway_container_decorations *deco,
+		int x, int y, int width) {
+	int border_thickness = config->titlebar_border_thickness;
+	int h_padding = config->titlebar_h_padding;
+	int height = container_titlebar_height();
+
+	deco->has_titlebar = true;
+	deco->titlebar = (struct wlr_box){ x, y, width, height };
+	deco->titlebar_edges[EDGE_TOP] =
+		(struct wlr_box){ x, y, width, border_thickness };
+	deco->titlebar_edges[EDGE_BOTTOM] = (struct wlr_box){
+		x, y + height - border_thickness, width, border_thickness };
+	deco->titlebar_edges[EDGE_LEFT] = (struct wlr_box){
+		x, y + border_thickness,
+		border_thickness, height - border_thickness * 2 };
+	deco->titlebar_edges[EDGE_RIGHT] = (struct wlr_box){
+		x + width - border_thickness, y + border_thickness,
+		border_thickness, height - border_thickness * 2 };
+	deco->titlebar_background = (struct wlr_box){
+		x + border_thickness, y + border_thickness,
+		width - border_thickness * 2, height - border_thickness * 2 };
+	deco->titlebar_padding[0] = (struct wlr_box){
+		x + border_thickness, y + border_thickness,
+		h_padding - border_thickness, height - border_thickness * 2 };
+	deco->titlebar_padding[1] = (struct wlr_box){
+		x + width - h_padding, y + border_thickness,
+		h_padding - border_thickness, height - border_thickness * 2 };
+}
+
+void container_update_decorations(struct sway_container *con) {
+	struct sway_container_state *state = &con->current;
+	struct sway_container_decorations *deco = &state->decorations;
+	memset(deco, 0, sizeof(struct sway_container_decorations));
+	if (!state->workspace) {
+		return;
+	}
+
+	// Floating containers are decorated like children of a linear layout
+	enum sway_container_layout layout = L_NONE;
+	list_t *siblings = NULL;
+	struct wlr_box parent_box;
+	if (state->parent) {
+		struct sway_container_state *parent = &state->parent->current;
+		layout = parent->layout;
+		siblings = parent->children;
+		parent_box = (struct wlr_box){
+			parent->x, parent->y, parent->width, parent->height };
+	} else if (list_find(state->workspace->current.tiling, con) != -1) {
+		struct sway_workspace_state *ws = &state->workspace->current;
+		layout = ws->layout;
+		siblings = ws->tiling;
+		parent_box = (struct wlr_box){ ws->x, ws->y, ws->width, ws->height };
+	}
+	int index = siblings ? list_find(siblings, con) : -1;
+	if (index == -1 || (config->hide_lone_tab && siblings->length == 1 &&
+				con->view)) {
+		layout = L_NONE;
+	}
+
+	if (layout == L_TABBED) {
+		int tab_width = parent_box.width / siblings->length;
+		int width = index == siblings->length - 1 ?
+			parent_box.width - tab_width * index : tab_width;
+		set_titlebar_geometry(deco, state->x + tab_width * index,
+				parent_box.y, width);
+	} else if (layout == L_STACKED) {
+		set_titlebar_geometry(deco, parent_box.x,
+				parent_box.y + container_titlebar_height() * index,
+				parent_box.width);
+	} else if (con->view && state->border == B_NORMAL) {
+		set_titlebar_geometry(deco, state->x, state->y, state->width);
+	}
+
+	if (!con->view ||
+			(state->border != B_PIXEL && state->border != B_NORMAL)) {
+		return;
+	}
+	if (state->border_top && state->border == B_PIXEL &&
+			layout != L_TABBED && layout != L_STACKED) {
+		deco->borders[EDGE_TOP] = (struct wlr_box){
+			state->x, state->y, state->width, state->border_thickness };
+	}
+	if (state->border_left) {
+		deco->borders[EDGE_LEFT] = (struct wlr_box){
+			state->x, state->content_y,
+			state->border_thickness, state->content_height };
+	}
+	if (state->border_right) {
+		deco->borders[EDGE_RIGHT] = (struct wlr_box){
+			state->content_x + state->content_width, state->content_y,
+			state->border_thickness, state->content_height };
+	}
+	if (state->border_bottom) {
+		deco->borders[EDGE_BOTTOM] = (struct wlr_box){
+			state->x, state->content_y + state->content_height,
+			state->width, state->border_thickness };
+	}
+	for (int i = 0; i < 4; ++i) {
+		box_add(&deco->border_bounds, &deco->borders[i]);
+	}
+
+	list_t *current_siblings = container_get_current_siblings(con);
+	enum sway_container_layout parent_layout =
+		container_current_parent_layout(con);
+	if (state->parent && current_siblings->length == 1) {
+		deco->right_indicator = parent_layout == L_HORIZ;
+		deco->bottom_indicator = parent_layout == L_VERT;
+	}
+}
+
 void container_handle_fullscreen_reparent(struct sway_container *con) {
 	if (con->fullscreen_mode != FULLSCREEN_WORKSPACE || !con->workspace ||
 			con->workspace->fullscreen == con) {
@@ -1494,20 +1623,7 @@ void container_add_mark(struct sway_container *con, char *mark) {
 	ipc_event_window(con, "mark");
 }
 
-static void update_marks_texture(struct sway_container *con,
-		struct wlr_texture **texture, struct border_colors *class) {
-	struct sway_output *output = container_get_effective_output(con);
-	if (!output) {
-		return;
-	}
-	if (*texture) {
-		wlr_texture_destroy(*texture);
-		*texture = NULL;
-	}
-	if (!con->marks->length) {
-		return;
-	}
-
+static char *format_marks(struct sway_container *con) {
 	size_t len = 0;
 	for (int i = 0; i < con->marks->length; ++i) {
 		char *mark = con->marks->items[i];
@@ -1515,12 +1631,16 @@ static void update_marks_texture(struct sway_container *con,
 			len += strlen(mark) + 2;
 		}
 	}
+	if (len == 0) {
+		return NULL;
+	}
 	char *buffer = calloc(len + 1, 1);
 	char *part = malloc(len + 1);
 
 	if (!sway_assert(buffer && part, "Unable to allocate memory")) {
 		free(buffer);
-		return;
+		free(part);
+		return NULL;
 	}
 
 	for (int i = 0; i < con->marks->length; ++i) {
@@ -1531,55 +1651,16 @@ static void update_marks_texture(struct sway_container *con,
 		}
 	}
 	free(part);
-
-	double scale = output->wlr_output->scale;
-	int width = 0;
-	int height = con->title_height * scale;
-
-	cairo_t *c = cairo_create(NULL);
-	get_text_size(c, config->font, &width, NULL, NULL, scale, false,
-			"%s", buffer);
-	cairo_destroy(c);
-
-	cairo_surface_t *surface = cairo_image_surface_create(
-			CAIRO_FORMAT_ARGB32, width, height);
-	cairo_t *cairo = cairo_create(surface);
-	cairo_set_source_rgba(cairo, class->background[0], class->background[1],
-			class->background[2], class->background[3]);
-	cairo_paint(cairo);
-	PangoContext *pango = pango_cairo_create_context(cairo);
-	cairo_set_antialias(cairo, CAIRO_ANTIALIAS_BEST);
-	cairo_set_source_rgba(cairo, class->text[0], class->text[1],
-			class->text[2], class->text[3]);
-	cairo_move_to(cairo, 0, 0);
-
-	pango_printf(cairo, config->font, scale, false, "%s", buffer);
-
-	cairo_surface_flush(surface);
-	unsigned char *data = cairo_image_surface_get_data(surface);
-	int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
-	struct wlr_renderer *renderer = wlr_backend_get_renderer(
-			output->wlr_output->backend);
-	*texture = wlr_texture_from_pixels(
-			renderer, WL_SHM_FORMAT_ARGB8888, stride, width, height, data);
-	cairo_surface_destroy(surface);
-	g_object_unref(pango);
-	cairo_destroy(cairo);
-	free(buffer);
+	return buffer;
 }
 
 void container_update_marks_textures(struct sway_container *con) {
-	if (!config->show_marks) {
-		return;
-	}
-	update_marks_texture(con, &con->marks_focused,
-			&config->border_colors.focused);
-	update_marks_texture(con, &con->marks_focused_inactive,
-			&config->border_colors.focused_inactive);
-	update_marks_texture(con, &con->marks_unfocused,
-			&config->border_colors.unfocused);
-	update_marks_texture(con, &con->marks_urgent,
-			&config->border_colors.urgent);
+	free(con->formatted_marks);
+	con->formatted_marks = format_marks(con);
+	clear_title_texture(&con->marks_focused);
+	clear_title_texture(&con->marks_focused_inactive);
+	clear_title_texture(&con->marks_unfocused);
+	clear_title_texture(&con->marks_urgent);
 	container_damage_whole(con);
 }
 
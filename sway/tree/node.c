@@ -1,4 +1,7 @@
 #define _POSIX_C_SOURCE 200809L
+#include <json.h>
+#include <stdlib.h>
+#include <string.h>
 #include "sway/output.h"
 #include "sway/server.h"
 #include "sway/tree/container.h"
@@ -30,6 +33,7 @@ const char *node_type_to_str(enum sway_node_type type) {
 }
 
 void node_set_dirty(struct sway_node *node) {
+	node_invalidate_ipc_json(node);
 	if (node->dirty) {
 		return;
 	}
@@ -37,6 +41,14 @@ void node_set_dirty(struct sway_node *node) {
 	list_add(server.dirty_nodes, node);
 }
 
+void node_invalidate_ipc_json(struct sway_node *node) {
+	free(node->ipc_json);
+	node->ipc_json = NULL;
+	node->ipc_json_len = 0;
+	json_object_put(node->ipc_json_object);
+	node->ipc_json_object = NULL;
+}
+
 bool node_is_view(struct sway_node *node) {
 	return node->type == N_CONTAINER && node->sway_container->view;
 }
@@ -159,3 +171,43 @@ bool node_has_ancestor(struct sway_node *node, struct sway_node *ancestor) {
 	}
 	return false;
 }
+
+struct node_state_list {
+	list_t list; // Must be first, the list is cast back to this struct
+	size_t refcount;
+};
+
+list_t *node_state_list_share(list_t *shared, list_t *items) {
+	if (shared && shared->length == items->length &&
+			memcmp(shared->items, items->items,
+				items->length * sizeof(void *)) == 0) {
+		((struct node_state_list *)shared)->refcount++;
+		return shared;
+	}
+
+	struct node_state_list *copy = calloc(1, sizeof(struct node_state_list));
+	if (!sway_assert(copy, "Unable to allocate state list")) {
+		return NULL;
+	}
+	copy->refcount = 1;
+	copy->list.capacity = items->length > 0 ? items->length : 1;
+	copy->list.length = items->length;
+	copy->list.items = malloc(copy->list.capacity * sizeof(void *));
+	if (!sway_assert(copy->list.items, "Unable to allocate state list")) {
+		free(copy);
+		return NULL;
+	}
+	memcpy(copy->list.items, items->items, items->length * sizeof(void *));
+	return &copy->list;
+}
+
+void node_state_list_unref(list_t *list) {
+	if (!list) {
+		return;
+	}
+	struct node_state_list *shared = (struct node_state_list *)list;
+	if (--shared->refcount == 0) {
+		free(shared->list.items);
+		free(shared);
+	}
+}
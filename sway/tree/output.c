@@ -94,13 +94,15 @@ struct sway_output *output_create(struct wlr_output *wlr_output) {
 	wlr_output->data = output;
 	output->detected_subpixel = wlr_output->subpixel;
 	output->scale_filter = SCALE_FILTER_NEAREST;
+	render_stats_reset(&output->render_stats);
 
 	wl_signal_init(&output->events.destroy);
 
 	wl_list_insert(&root->all_outputs, &output->link);
 
 	output->workspaces = create_list();
-	output->current.workspaces = create_list();
+	output->current.workspaces =
+		node_state_list_share(NULL, output->workspaces);
 
 	size_t len = sizeof(output->layers) / sizeof(output->layers[0]);
 	for (size_t i = 0; i < len; ++i) {
@@ -233,8 +235,9 @@ void output_destroy(struct sway_output *output) {
 				"which is still referenced by transactions")) {
 		return;
 	}
+	ipc_tree_delta_forget(&output->node);
 	list_free(output->workspaces);
-	list_free(output->current.workspaces);
+	node_state_list_unref(output->current.workspaces);
 	wl_event_source_remove(output->repaint_timer);
 	free(output);
 }
@@ -1,6 +1,7 @@
 #define _POSIX_C_SOURCE 200809L
 #include <stdlib.h>
 #include <strings.h>
+#include <time.h>
 #include <wayland-server-core.h>
 #include <wlr/render/wlr_renderer.h>
 #include <wlr/types/wlr_buffer.h>
@@ -23,8 +24,10 @@
 #include "sway/output.h"
 #include "sway/input/seat.h"
 #include "sway/server.h"
+#include "sway/surface.h"
 #include "sway/tree/arrange.h"
 #include "sway/tree/container.h"
+#include "sway/tree/root.h"
 #include "sway/tree/view.h"
 #include "sway/tree/workspace.h"
 #include "sway/config.h"
@@ -436,6 +439,52 @@ void view_damage_from(struct sway_view *view) {
 	}
 }
 
+void view_record_commit_latency(struct sway_view *view) {
+	if (!view->max_render_time_adaptive || !view->surface) {
+		return;
+	}
+	struct sway_surface *surface = view->surface->data;
+	if (!surface || !surface->frame_done_pending) {
+		return;
+	}
+	surface->frame_done_pending = false;
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (now.tv_sec < surface->frame_done_time.tv_sec) {
+		return;
+	}
+	uint32_t refresh_nsec = 0;
+	struct sway_workspace *ws = view->container ?
+		view->container->workspace : NULL;
+	if (ws && ws->output) {
+		refresh_nsec = ws->output->refresh_nsec;
+	}
+
+	// A commit arriving more than a refresh period after the frame done
+	// event comes from a client which was idle, not one racing the repaint
+	time_t elapsed_sec = now.tv_sec - surface->frame_done_time.tv_sec;
+	if (refresh_nsec > 0 && elapsed_sec > 1) {
+		return;
+	}
+	uint32_t usec = elapsed_sec * 1000000 +
+		(now.tv_nsec - surface->frame_done_time.tv_nsec) / 1000;
+	if (refresh_nsec > 0 && usec > refresh_nsec / 1000) {
+		return;
+	}
+	bool missed = now.tv_sec > surface->frame_deadline.tv_sec ||
+		(now.tv_sec == surface->frame_deadline.tv_sec &&
+		 now.tv_nsec > surface->frame_deadline.tv_nsec);
+
+	int max_render_time = adaptive_render_time_update(
+		&view->adaptive_render_time, usec, missed, refresh_nsec);
+	if (max_render_time != view->max_render_time) {
+		sway_log(SWAY_DEBUG, "View %p: adapting max render time to %d",
+			view, max_render_time);
+		view->max_render_time = max_render_time;
+	}
+}
+
 void view_for_each_surface(struct sway_view *view,
 		wlr_surface_iterator_func_t iterator, void *user_data) {
 	if (!view->surface) {
@@ -484,6 +533,10 @@ static bool view_has_executed_criteria(struct sway_view *view,
 }
 
 void view_execute_criteria(struct sway_view *view) {
+	if (view->container) {
+		// The app_id, class, role or window type may have changed
+		node_invalidate_ipc_json(&view->container->node);
+	}
 	list_t *criterias = criteria_for_view(view, CT_COMMAND);
 	for (int i = 0; i < criterias->length; i++) {
 		struct criteria *criteria = criterias->items[i];
@@ -798,6 +851,17 @@ void view_map(struct sway_view *view, struct wlr_surface *wlr_surface,
 	}
 }
 
+static void remove_pending_title(struct sway_view *view) {
+	if (!view->title_pending) {
+		return;
+	}
+	int index = list_find(server.pending_titles, view);
+	if (index != -1) {
+		list_del(server.pending_titles, index);
+	}
+	view->title_pending = false;
+}
+
 void view_unmap(struct sway_view *view) {
 	wl_signal_emit(&view->events.unmap, view);
 
@@ -808,6 +872,8 @@ void view_unmap(struct sway_view *view) {
 		view->urgent_timer = NULL;
 	}
 
+	remove_pending_title(view);
+
 	if (view->foreign_toplevel) {
 		wlr_foreign_toplevel_handle_v1_destroy(view->foreign_toplevel);
 		view->foreign_toplevel = NULL;
@@ -1183,16 +1249,20 @@ static size_t parse_title_format(struct sway_view *view, char *buffer) {
 	return len;
 }
 
-void view_update_title(struct sway_view *view, bool force) {
+/**
+ * Update the container's title strings and title height from the view's title
+ * property. Returns false if nothing changed.
+ */
+static bool update_title_strings(struct sway_view *view, bool force) {
 	const char *title = view_get_title(view);
 
 	if (!force) {
 		if (title && view->container->title &&
 				strcmp(title, view->container->title) == 0) {
-			return;
+			return false;
 		}
 		if (!title && !view->container->title) {
-			return;
+			return false;
 		}
 	}
 
@@ -1202,7 +1272,9 @@ void view_update_title(struct sway_view *view, bool force) {
 		size_t len = parse_title_format(view, NULL);
 		char *buffer = calloc(len + 1, sizeof(char));
 		if (!sway_assert(buffer, "Unable to allocate title string")) {
-			return;
+			view->container->title = NULL;
+			view->container->formatted_title = NULL;
+			return false;
 		}
 		parse_title_format(view, buffer);
 
@@ -1213,18 +1285,191 @@ void view_update_title(struct sway_view *view, bool force) {
 		view->container->formatted_title = NULL;
 	}
 	container_calculate_title_height(view->container);
-	config_update_font_height(false);
+	return true;
+}
 
-	// Update title after the global font height is updated
+/**
+ * Finish a title update once the global font height has been updated.
+ */
+static void finish_title_update(struct sway_view *view) {
 	container_update_title_textures(view->container);
 
 	ipc_event_window(view->container, "title");
 
+	const char *title = view_get_title(view);
 	if (view->foreign_toplevel && title) {
 		wlr_foreign_toplevel_handle_v1_set_title(view->foreign_toplevel, title);
 	}
 }
 
+void view_update_title(struct sway_view *view, bool force) {
+	remove_pending_title(view);
+	if (!update_title_strings(view, force)) {
+		return;
+	}
+	config_update_font_height(false);
+
+	// Update title after the global font height is updated
+	finish_title_update(view);
+}
+
+static void apply_pending_titles(void) {
+	clock_gettime(CLOCK_MONOTONIC, &server.last_title_update);
+	if (server.title_update_timer) {
+		wl_event_source_timer_update(server.title_update_timer, 0);
+	}
+
+	bool changed = false;
+	for (int i = 0; i < server.pending_titles->length; ++i) {
+		struct sway_view *view = server.pending_titles->items[i];
+		view->title_pending = update_title_strings(view, false);
+		changed = changed || view->title_pending;
+	}
+	if (changed) {
+		config_update_font_height(false);
+	}
+	for (int i = 0; i < server.pending_titles->length; ++i) {
+		struct sway_view *view = server.pending_titles->items[i];
+		if (view->title_pending) {
+			view->title_pending = false;
+			finish_title_update(view);
+		}
+	}
+	server.pending_titles->length = 0;
+
+	transaction_commit_dirty();
+}
+
+static int handle_title_update_timer(void *data) {
+	apply_pending_titles();
+	return 0;
+}
+
+// Upper bound for how long a queued title may wait for an output frame
+#define TITLE_UPDATE_FALLBACK_MSEC 50
+
+static int get_msec_until_title_update(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	long elapsed = (now.tv_sec - server.last_title_update.tv_sec) * 1000 +
+		(now.tv_nsec - server.last_title_update.tv_nsec) / 1000000;
+	long remaining = config->title_update_interval - elapsed;
+	return remaining > 0 ? remaining : 0;
+}
+
+void view_queue_title_update(struct sway_view *view) {
+	if (view->title_pending) {
+		return;
+	}
+	const char *title = view_get_title(view);
+	const char *current = view->container->title;
+	if ((!title && !current) ||
+			(title && current && strcmp(title, current) == 0)) {
+		return;
+	}
+
+	view->title_pending = true;
+	list_add(server.pending_titles, view);
+
+	// Titles are normally applied on the next frame of an output showing the
+	// view. The timer covers hidden views and the title_update_interval.
+	for (int i = 0; i < view->container->outputs->length; ++i) {
+		struct sway_output *output = view->container->outputs->items[i];
+		if (output->wlr_output) {
+			wlr_output_schedule_frame(output->wlr_output);
+		}
+	}
+
+	if (server.pending_titles->length > 1) {
+		// The timer has already been armed by the first pending title
+		return;
+	}
+	if (!server.title_update_timer) {
+		server.title_update_timer = wl_event_loop_add_timer(
+				server.wl_event_loop, handle_title_update_timer, NULL);
+	}
+	int delay = get_msec_until_title_update();
+	if (delay < TITLE_UPDATE_FALLBACK_MSEC) {
+		delay = TITLE_UPDATE_FALLBACK_MSEC;
+	}
+	wl_event_source_timer_update(server.title_update_timer, delay);
+}
+
+void view_update_pending_titles(void) {
+	if (!server.pending_titles->length || get_msec_until_title_update() > 0) {
+		return;
+	}
+	apply_pending_titles();
+}
+
+struct occluded_frame_data {
+	struct timespec now;
+	long interval_nsec;
+};
+
+static void send_occluded_frame_done(struct wlr_surface *surface,
+		int sx, int sy, void *_data) {
+	struct occluded_frame_data *data = _data;
+	struct sway_surface *sway_surface = surface->data;
+	if (!sway_surface) {
+		return;
+	}
+
+	// Surfaces which are being shown got a frame done event recently
+	long elapsed_nsec =
+		(data->now.tv_sec - sway_surface->frame_done_time.tv_sec) * 1000000000L +
+		(data->now.tv_nsec - sway_surface->frame_done_time.tv_nsec);
+	if (data->now.tv_sec - sway_surface->frame_done_time.tv_sec < 2 &&
+			elapsed_nsec < data->interval_nsec) {
+		return;
+	}
+
+	wlr_surface_send_frame_done(surface, &data->now);
+	sway_surface->frame_done_time = data->now;
+	// The client isn't racing a repaint, so don't learn from its latency
+	sway_surface->frame_done_pending = false;
+}
+
+static void send_occluded_frames_iterator(struct sway_container *con,
+		void *data) {
+	if (con->view && con->view->surface) {
+		view_for_each_surface(con->view, send_occluded_frame_done, data);
+	}
+}
+
+static int handle_occluded_frame_timer(void *data) {
+	if (config->occluded_frame_rate <= 0) {
+		return 0;
+	}
+
+	struct occluded_frame_data frame_data = {
+		.interval_nsec = 1000000000L / config->occluded_frame_rate,
+	};
+	clock_gettime(CLOCK_MONOTONIC, &frame_data.now);
+	root_for_each_container(send_occluded_frames_iterator, &frame_data);
+
+	view_schedule_occluded_frames();
+	return 0;
+}
+
+void view_schedule_occluded_frames(void) {
+	if (!server.occluded_frame_timer) {
+		if (config->occluded_frame_rate <= 0) {
+			return;
+		}
+		server.occluded_frame_timer = wl_event_loop_add_timer(
+				server.wl_event_loop, handle_occluded_frame_timer, NULL);
+	}
+	int delay = 0;
+	if (config->occluded_frame_rate > 0) {
+		delay = 1000 / config->occluded_frame_rate;
+		if (delay < 1) {
+			delay = 1;
+		}
+	}
+	wl_event_source_timer_update(server.occluded_frame_timer, delay);
+}
+
 bool view_is_visible(struct sway_view *view) {
 	if (view->container->node.destroying) {
 		return false;
@@ -129,13 +129,15 @@ void workspace_destroy(struct sway_workspace *workspace) {
 		return;
 	}
 
+	node_invalidate_ipc_json(&workspace->node);
+	ipc_tree_delta_forget(&workspace->node);
 	free(workspace->name);
 	free(workspace->representation);
 	list_free_items_and_destroy(workspace->output_priority);
 	list_free(workspace->floating);
 	list_free(workspace->tiling);
-	list_free(workspace->current.floating);
-	list_free(workspace->current.tiling);
+	node_state_list_unref(workspace->current.floating);
+	node_state_list_unref(workspace->current.tiling);
 	free(workspace);
 }
 
@@ -796,6 +798,7 @@ void workspace_update_representation(struct sway_workspace *ws) {
 		return;
 	}
 	container_build_representation(ws->layout, ws->tiling, ws->representation);
+	node_invalidate_ipc_json(&ws->node);
 }
 
 void workspace_get_box(struct sway_workspace *workspace, struct wlr_box *box) {
@@ -7,6 +7,7 @@
 #include "swaybar/bar.h"
 #include "ipc-client.h"
 #include "log.h"
+#include "pango.h"
 
 static struct swaybar swaybar;
 
@@ -100,5 +101,6 @@ int main(int argc, char **argv) {
 	swaybar.running = true;
 	bar_run(&swaybar);
 	bar_teardown(&swaybar);
+	pango_cache_fini();
 	return 0;
 }
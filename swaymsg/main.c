@@ -11,6 +11,7 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <json.h>
+#include "cbor.h"
 #include "stringop.h"
 #include "ipc-client.h"
 #include "log.h"
@@ -334,9 +335,22 @@ static void pretty_print(int type, json_object *resp) {
 	}
 }
 
+static json_object *parse_response(const char *payload, uint32_t len,
+		bool cbor) {
+	if (!cbor) {
+		return json_tokener_parse(payload);
+	}
+	json_object *obj = NULL;
+	if (!cbor_decode_json((const uint8_t *)payload, len, &obj)) {
+		return NULL;
+	}
+	return obj;
+}
+
 int main(int argc, char **argv) {
 	static bool quiet = false;
 	static bool raw = false;
+	static bool cbor = false;
 	static bool monitor = false;
 	char *socket_path = NULL;
 	char *cmdtype = NULL;
@@ -344,6 +358,7 @@ int main(int argc, char **argv) {
 	sway_log_init(SWAY_INFO, NULL);
 
 	static struct option long_options[] = {
+		{"cbor", no_argument, NULL, 'c'},
 		{"help", no_argument, NULL, 'h'},
 		{"monitor", no_argument, NULL, 'm'},
 		{"pretty", no_argument, NULL, 'p'},
@@ -358,6 +373,7 @@ int main(int argc, char **argv) {
 	const char *usage =
 		"Usage: swaymsg [options] [message]\n"
 		"\n"
+		"  -c, --cbor             Receive CBOR instead of JSON from sway.\n"
 		"  -h, --help             Show help message and quit.\n"
 		"  -m, --monitor          Monitor until killed (-t SUBSCRIBE only)\n"
 		"  -p, --pretty           Use pretty output even when not using a tty\n"
@@ -372,11 +388,14 @@ int main(int argc, char **argv) {
 	int c;
 	while (1) {
 		int option_index = 0;
-		c = getopt_long(argc, argv, "hmpqrs:t:v", long_options, &option_index);
+		c = getopt_long(argc, argv, "chmpqrs:t:v", long_options, &option_index);
 		if (c == -1) {
 			break;
 		}
 		switch (c) {
+		case 'c': // CBOR
+			cbor = true;
+			break;
 		case 'm': // Monitor
 			monitor = true;
 			break;
@@ -444,6 +463,10 @@ int main(int argc, char **argv) {
 		type = IPC_GET_BINDING_STATE;
 	} else if (strcasecmp(cmdtype, "get_config") == 0) {
 		type = IPC_GET_CONFIG;
+	} else if (strcasecmp(cmdtype, "get_render_stats") == 0) {
+		type = IPC_GET_RENDER_STATS;
+	} else if (strcasecmp(cmdtype, "get_transaction_trace") == 0) {
+		type = IPC_GET_TRANSACTION_TRACE;
 	} else if (strcasecmp(cmdtype, "send_tick") == 0) {
 		type = IPC_SEND_TICK;
 	} else if (strcasecmp(cmdtype, "subscribe") == 0) {
@@ -476,16 +499,24 @@ int main(int argc, char **argv) {
 	int socketfd = ipc_open_socket(socket_path);
 	struct timeval timeout = {.tv_sec = 3, .tv_usec = 0};
 	ipc_set_recv_timeout(socketfd, timeout);
+	if (cbor && !ipc_set_encoding(socketfd, "cbor")) {
+		close(socketfd);
+		free(command);
+		free(socket_path);
+		return 1;
+	}
 	uint32_t len = strlen(command);
 	char *resp = ipc_single_command(socketfd, type, command, &len);
 
 	// pretty print the json
-	json_object *obj = json_tokener_parse(resp);
+	json_object *obj = parse_response(resp, len, cbor);
 	if (obj == NULL) {
 		if (!quiet) {
-			fprintf(stderr, "ERROR: Could not parse json response from ipc. "
-					"This is a bug in sway.");
-			printf("%s\n", resp);
+			fprintf(stderr, "ERROR: Could not parse %s response from ipc. "
+					"This is a bug in sway.", cbor ? "cbor" : "json");
+			if (!cbor) {
+				printf("%s\n", resp);
+			}
 		}
 		ret = 1;
 	} else {
@@ -517,11 +548,12 @@ int main(int argc, char **argv) {
 				break;
 			}
 
-			json_object *obj = json_tokener_parse(reply->payload);
+			json_object *obj =
+				parse_response(reply->payload, reply->size, cbor);
 			if (obj == NULL) {
 				if (!quiet) {
-					fprintf(stderr, "ERROR: Could not parse json response from"
-							" ipc. This is a bug in sway.");
+					fprintf(stderr, "ERROR: Could not parse %s response from"
+							" ipc. This is a bug in sway.", cbor ? "cbor" : "json");
 					ret = 1;
 				}
 				break;
@@ -0,0 +1,252 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cbor.h"
+
+static int failures = 0;
+
+#define check(cond, ...) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+		fprintf(stderr, __VA_ARGS__); \
+		fprintf(stderr, "\n"); \
+		failures++; \
+	} \
+} while (0)
+
+/**
+ * Check that a value is encoded as the expected bytes and decodes back to an
+ * equal value. Takes ownership of the value.
+ */
+static void check_encoding(const char *name, json_object *obj,
+		const uint8_t *expected, size_t expected_len) {
+	size_t len = 0;
+	uint8_t *data = cbor_encode_json(obj, &len);
+	check(data != NULL, "%s: encoding failed", name);
+	if (!data) {
+		json_object_put(obj);
+		return;
+	}
+	if (expected) {
+		check(len == expected_len && memcmp(data, expected, len) == 0,
+			"%s: unexpected encoding", name);
+	}
+
+	json_object *decoded = NULL;
+	check(cbor_decode_json(data, len, &decoded), "%s: decoding failed", name);
+	check(json_object_equal(obj, decoded), "%s: round trip changed value",
+		name);
+
+	json_object_put(decoded);
+	json_object_put(obj);
+	free(data);
+}
+
+static void check_round_trip(const char *name, json_object *obj) {
+	check_encoding(name, obj, NULL, 0);
+}
+
+static void check_malformed(const char *name, const uint8_t *data,
+		size_t len) {
+	json_object *decoded = NULL;
+	check(!cbor_decode_json(data, len, &decoded),
+		"%s: malformed input was accepted", name);
+}
+
+static void test_ints(void) {
+	static const struct {
+		int64_t value;
+		uint8_t bytes[9];
+		size_t len;
+	} cases[] = {
+		{ 0, { 0x00 }, 1 },
+		{ 23, { 0x17 }, 1 },
+		{ 24, { 0x18, 0x18 }, 2 },
+		{ 255, { 0x18, 0xff }, 2 },
+		{ 256, { 0x19, 0x01, 0x00 }, 3 },
+		{ 65535, { 0x19, 0xff, 0xff }, 3 },
+		{ 65536, { 0x1a, 0x00, 0x01, 0x00, 0x00 }, 5 },
+		{ 4294967295LL, { 0x1a, 0xff, 0xff, 0xff, 0xff }, 5 },
+		{ 4294967296LL,
+			{ 0x1b, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00 }, 9 },
+		{ INT64_MAX,
+			{ 0x1b, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff }, 9 },
+		{ -1, { 0x20 }, 1 },
+		{ -24, { 0x37 }, 1 },
+		{ -25, { 0x38, 0x18 }, 2 },
+		{ -256, { 0x38, 0xff }, 2 },
+		{ -257, { 0x39, 0x01, 0x00 }, 3 },
+		{ -65537, { 0x3a, 0x00, 0x01, 0x00, 0x00 }, 5 },
+		{ -4294967297LL,
+			{ 0x3b, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00 }, 9 },
+		{ INT64_MIN,
+			{ 0x3b, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff }, 9 },
+	};
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+		char name[64];
+		snprintf(name, sizeof(name), "int %lld", (long long)cases[i].value);
+		check_encoding(name, json_object_new_int64(cases[i].value),
+			cases[i].bytes, cases[i].len);
+	}
+
+	// Larger than any JSON integer
+	static const uint8_t too_large[] =
+		{ 0x1b, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	check_malformed("uint above INT64_MAX", too_large, sizeof(too_large));
+	static const uint8_t too_small[] =
+		{ 0x3b, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	check_malformed("negint below INT64_MIN", too_small, sizeof(too_small));
+}
+
+static void test_doubles(void) {
+	static const uint8_t one_and_a_half[] =
+		{ 0xfb, 0x3f, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	check_encoding("double 1.5", json_object_new_double(1.5),
+		one_and_a_half, sizeof(one_and_a_half));
+	check_round_trip("double -0.25", json_object_new_double(-0.25));
+	check_round_trip("double 1e300", json_object_new_double(1e300));
+	check_round_trip("double 1e-300", json_object_new_double(1e-300));
+
+	static const uint8_t float32[] = { 0xfa, 0x3f, 0xc0, 0x00, 0x00 };
+	json_object *decoded = NULL;
+	check(cbor_decode_json(float32, sizeof(float32), &decoded),
+		"float32: decoding failed");
+	check(json_object_get_type(decoded) == json_type_double &&
+		json_object_get_double(decoded) == 1.5,
+		"float32: unexpected value");
+	json_object_put(decoded);
+}
+
+static void test_simple(void) {
+	static const uint8_t f[] = { 0xf4 }, t[] = { 0xf5 }, n[] = { 0xf6 };
+	check_encoding("false", json_object_new_boolean(0), f, sizeof(f));
+	check_encoding("true", json_object_new_boolean(1), t, sizeof(t));
+	check_encoding("null", NULL, n, sizeof(n));
+
+	static const uint8_t undefined[] = { 0xf7 };
+	json_object *sentinel = json_object_new_object();
+	json_object *decoded = sentinel;
+	check(cbor_decode_json(undefined, sizeof(undefined), &decoded) &&
+		decoded == NULL, "undefined: not decoded as null");
+	json_object_put(sentinel);
+
+	static const uint8_t text[] = { 0x65, 'h', 'e', 'l', 'l', 'o' };
+	check_encoding("text", json_object_new_string("hello"),
+		text, sizeof(text));
+	check_round_trip("empty text", json_object_new_string(""));
+	check_round_trip("text with null byte",
+		json_object_new_string_len("a\0b", 3));
+}
+
+static json_object *create_nested(void) {
+	json_object *inner = json_object_new_object();
+	json_object_object_add(inner, "id", json_object_new_int(4));
+	json_object_object_add(inner, "name", json_object_new_string("sway"));
+	json_object_object_add(inner, "percent", NULL);
+	json_object_object_add(inner, "ratio", json_object_new_double(0.5));
+
+	json_object *nodes = json_object_new_array();
+	json_object_array_add(nodes, inner);
+	json_object_array_add(nodes, json_object_new_array());
+	json_object_array_add(nodes, json_object_new_boolean(1));
+
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "nodes", nodes);
+	json_object_object_add(object, "empty", json_object_new_object());
+	json_object_object_add(object, "negative", json_object_new_int(-1000));
+	return object;
+}
+
+static void test_nested(void) {
+	static const uint8_t small[] = {
+		0xa1, 0x61, 'a', 0x82, 0x01, 0xa1, 0x61, 'b', 0xf6,
+	};
+	json_object *inner = json_object_new_object();
+	json_object_object_add(inner, "b", NULL);
+	json_object *array = json_object_new_array();
+	json_object_array_add(array, json_object_new_int(1));
+	json_object_array_add(array, inner);
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "a", array);
+	check_encoding("small map", object, small, sizeof(small));
+
+	check_round_trip("nested map", create_nested());
+
+	// 24 entries need a one byte length
+	json_object *large = json_object_new_array();
+	for (int i = 0; i < 24; ++i) {
+		json_object_array_add(large, json_object_new_int(i));
+	}
+	size_t len = 0;
+	uint8_t *data = cbor_encode_json(large, &len);
+	check(data && len == 26 && data[0] == 0x98 && data[1] == 24,
+		"array of 24: unexpected length encoding");
+	free(data);
+	check_round_trip("array of 24", large);
+}
+
+static void test_malformed(void) {
+	check_malformed("empty input", NULL, 0);
+
+	static const uint8_t reserved[] = { 0x1c };
+	check_malformed("reserved additional info", reserved, sizeof(reserved));
+	static const uint8_t indefinite[] = { 0x9f, 0x01, 0xff };
+	check_malformed("indefinite length", indefinite, sizeof(indefinite));
+	static const uint8_t bytes[] = { 0x41, 'a' };
+	check_malformed("byte string", bytes, sizeof(bytes));
+	static const uint8_t tag[] = { 0xc0, 0x01 };
+	check_malformed("tag", tag, sizeof(tag));
+	static const uint8_t int_key[] = { 0xa1, 0x01, 0x02 };
+	check_malformed("integer map key", int_key, sizeof(int_key));
+	static const uint8_t simple[] = { 0xe0 };
+	check_malformed("unassigned simple value", simple, sizeof(simple));
+	static const uint8_t trailing[] = { 0x01, 0x01 };
+	check_malformed("trailing bytes", trailing, sizeof(trailing));
+	static const uint8_t huge_array[] =
+		{ 0x9b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	check_malformed("huge array length", huge_array, sizeof(huge_array));
+	static const uint8_t huge_text[] = { 0x7a, 0x7f, 0xff, 0xff, 0xff };
+	check_malformed("huge text length", huge_text, sizeof(huge_text));
+
+	uint8_t deep[1024];
+	memset(deep, 0x81, sizeof(deep) - 1);
+	deep[sizeof(deep) - 1] = 0x00;
+	check_malformed("deep nesting", deep, sizeof(deep));
+}
+
+static void test_truncated(void) {
+	json_object *object = create_nested();
+	size_t len = 0;
+	uint8_t *data = cbor_encode_json(object, &len);
+	json_object_put(object);
+	check(data != NULL, "truncated: encoding failed");
+	if (!data) {
+		return;
+	}
+	for (size_t i = 0; i < len; ++i) {
+		json_object *decoded = NULL;
+		if (cbor_decode_json(data, i, &decoded)) {
+			check(false, "truncated: %zu of %zu bytes were accepted", i, len);
+			json_object_put(decoded);
+		}
+	}
+	free(data);
+}
+
+int main(void) {
+	test_ints();
+	test_doubles();
+	test_simple();
+	test_nested();
+	test_malformed();
+	test_truncated();
+
+	if (failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	return 0;
+}